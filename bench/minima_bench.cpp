@@ -0,0 +1,298 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+// Headless timings of Document, History and saving on generated files, to
+// judge storage and algorithm changes by. Run as
+//   minima_bench [filter...]
+// where a filter like "prose" or "undo" keeps only the cases whose
+// "corpus/operation" name contains it.
+
+#include "Document.h"
+#include "History.h"
+#include "FileWriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+    const char *WORDS[] = {"the", "of", "and", "editor", "line", "buffer", "a", "to", "in", "is",
+                           "storage", "that", "for", "it", "with", "as", "was", "on", "undo", "caret"};
+
+    std::string word(std::mt19937 &rng) {
+        return WORDS[rng() % (sizeof WORDS / sizeof *WORDS)];
+    }
+
+    struct Corpus {
+        const char *name;
+        std::function<std::string(std::mt19937 &)> generate;
+    };
+
+    // a needle that only shows up once, near the end, so searches cross the whole file
+    const std::string NEEDLE = "zyzzyva";
+
+    const Corpus CORPORA[] = {
+        {"lines", [](std::mt19937 &rng) {
+            // 1M short lines, like a log or CSV
+            std::string text;
+            for(int i = 0; i < 1000000; i++) {
+                text += std::to_string(rng() % 100000) + "," + word(rng) + "," + word(rng) + "\n";
+                if(i == 990000)
+                    text += NEEDLE + "\n";
+            }
+            return text;
+        }},
+        {"long", [](std::mt19937 &rng) {
+            // 100 lines of about 100 KB each
+            std::string text;
+            for(int i = 0; i < 100; i++) {
+                while(text.size() < (size_t) (i + 1) * 100000)
+                    text += word(rng) + " ";
+                if(i == 98)
+                    text += NEEDLE;
+                text += "\n";
+            }
+            return text;
+        }},
+        {"single", [](std::mt19937 &rng) {
+            // one 50 MB line, minified JSON style
+            std::string text = "[";
+            while(text.size() < 50000000)
+                text += "{\"" + word(rng) + "\":" + std::to_string(rng() % 1000) + "},";
+            text += "\"" + NEEDLE + "\"]";
+            return text;
+        }},
+        {"prose", [](std::mt19937 &rng) {
+            // paragraphs of wrapped sentences, about 20 MB
+            std::string text;
+            while(text.size() < 20000000) {
+                int lines = 2 + (int) (rng() % 6);
+                for(int l = 0; l < lines; l++) {
+                    std::string line;
+                    while(line.size() < 70)
+                        line += word(rng) + (rng() % 9 == 0 ? ". " : " ");
+                    text += line + "\n";
+                }
+                text += "\n";
+            }
+            text += NEEDLE + "\n";
+            return text;
+        }},
+    };
+
+    std::vector<std::string> filters;
+
+    bool wanted(const std::string &name) {
+        if(filters.empty())
+            return true;
+        for(auto &filter : filters)
+            if(name.find(filter) != std::string::npos)
+                return true;
+        return false;
+    }
+
+    bool namesCorpus(const std::string &filter, const std::string &corpus) {
+        return corpus.find(filter) != std::string::npos || filter.rfind(corpus + "/", 0) == 0;
+    }
+
+    /**
+     * Whether any case on `corpus` could pass the filters, so the others
+     * aren't generated for nothing
+     */
+    bool corpusWanted(const std::string &corpus) {
+        if(filters.empty())
+            return true;
+        for(auto &filter : filters) {
+            bool anyCorpus = false;
+            for(const Corpus &other : CORPORA)
+                anyCorpus |= namesCorpus(filter, other.name);
+            if(!anyCorpus || namesCorpus(filter, corpus))
+                return true;
+        }
+        return false;
+    }
+
+    // a case stops early once it has run this long, so slow spots don't stall the rest
+    constexpr std::chrono::seconds CASE_LIMIT{2};
+
+    /**
+     * Time op(i) for i in [0, ops), or as many as fit in CASE_LIMIT, and
+     * print a row
+     */
+    void measure(const std::string &corpus, const std::string &operation, size_t ops,
+                 const std::function<void(size_t)> &op) {
+        std::string name = corpus + "/" + operation;
+        if(!wanted(name))
+            return;
+        auto begin = std::chrono::steady_clock::now();
+        size_t done = 0;
+        while(done < ops) {
+            op(done++);
+            if(std::chrono::steady_clock::now() - begin > CASE_LIMIT)
+                break;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        printf("%-32s %8zu ops %10.1f ms %12.2f us/op%s\n", name.c_str(), done, ms, ms * 1000 / (double) done,
+               done < ops ? "  (cut short)" : "");
+        fflush(stdout);
+    }
+
+    size_t totalBytes(Document &doc) {
+        auto &lines = doc.getLines();
+        size_t last = lines.size() - 1;
+        return lines.offsetOf(last) + lines.at(last).size();
+    }
+
+    Point randomPoint(Document &doc, std::mt19937 &rng) {
+        return doc.pointAt(rng() % (totalBytes(doc) + 1));
+    }
+
+    void runCorpus(const Corpus &corpus, const std::string &dir) {
+        std::mt19937 rng(42);
+        std::string path = dir + "/" + corpus.name + ".txt";
+        {
+            std::string text = corpus.generate(rng);
+            std::ofstream(path, std::ios::binary) << text;
+        }
+
+        // a fresh document per operation, so one doesn't warm up the next
+        auto fresh = [&path](Document &doc) {
+            doc.updateHistory = [](const Action &) {};
+            doc.load(FileMap::open(path));
+            (void) doc.getLines().size();
+        };
+        const int N = 2000;
+        std::string name = corpus.name;
+
+        measure(name, "load", 1, [&](size_t) {
+            Document doc;
+            fresh(doc);
+        });
+        {
+            Document doc;
+            fresh(doc);
+            measure(name, "save", 1, [&](size_t) {
+                FileWriter::save(path + ".out", doc.getLines());
+            });
+            unlink((path + ".out").c_str());
+        }
+        {
+            Document doc;
+            fresh(doc);
+            std::vector<Point> at;
+            for(int i = 0; i < N; i++)
+                at.push_back(randomPoint(doc, rng));
+            measure(name, "insertString char", N, [&](size_t i) {
+                doc.setCaret(at[i]);
+                doc.insertString("x");
+            });
+        }
+        {
+            Document doc;
+            fresh(doc);
+            std::string paste;
+            while(paste.size() < (1 << 20))
+                paste += word(rng) + (rng() % 10 == 0 ? "\n" : " ");
+            Point p = randomPoint(doc, rng);
+            measure(name, "insertString 1MB", 1, [&](size_t) {
+                doc.setCaret(p);
+                doc.insertString(paste);
+            });
+        }
+        {
+            Document doc;
+            fresh(doc);
+            measure(name, "deleteRange 10 chars", N, [&](size_t) {
+                Point p = randomPoint(doc, rng);
+                doc.deleteRange({p, doc.charOffset(p, 10)});
+            });
+        }
+        {
+            Document doc;
+            fresh(doc);
+            size_t total = totalBytes(doc);
+            Range half{doc.pointAt(total / 4), doc.pointAt(total * 3 / 4)};
+            measure(name, "deleteRange half", 1, [&](size_t) {
+                doc.deleteRange(half);
+            });
+        }
+        {
+            Document doc;
+            fresh(doc);
+            measure(name, "charOffset 10k", N, [&](size_t i) {
+                (void) doc.charOffset(randomPoint(doc, rng), i % 2 ? 10000 : -10000);
+            });
+            measure(name, "wordOffset 50", N, [&](size_t i) {
+                (void) doc.wordOffset(randomPoint(doc, rng), i % 2 ? 50 : -50);
+            });
+            measure(name, "paraOffset 5", N, [&](size_t i) {
+                (void) doc.paraOffset(randomPoint(doc, rng), i % 2 ? 5 : -5);
+            });
+            measure(name, "search text", 5, [&](size_t) {
+                (void) doc.search(Point::origin, NEEDLE, 1);
+            });
+            std::string error;
+            auto regex = Regex::compile(NEEDLE.substr(0, 3) + "[y]+va", false, error);
+            measure(name, "search regex", 5, [&](size_t) {
+                (void) doc.searchRegex(Point::origin, *regex, 1);
+            });
+            std::vector<Range> ranges;
+            for(int i = 0; i < 20; i++) {
+                Point p = randomPoint(doc, rng);
+                ranges.emplace_back(p, doc.pointAt(doc.byteOffset(p) + (1 << 20)));
+            }
+            measure(name, "selectionToString 1MB", ranges.size(), [&](size_t i) {
+                (void) doc.selectionToString(ranges[i]);
+            });
+        }
+        {
+            Document doc;
+            fresh(doc);
+            History history(doc);
+            doc.updateHistory = [&history](Action action) {
+                history.addAction(std::move(action));
+            };
+            for(int i = 0; i < N; i++) {
+                doc.setCaret(randomPoint(doc, rng));
+                doc.insertString("edit ");
+                history.seal();
+                if(i % 10 == 0) {
+                    Point p = randomPoint(doc, rng);
+                    doc.deleteRange({p, doc.pointAt(doc.byteOffset(p) + 5000)});
+                    history.seal();
+                }
+            }
+            size_t steps = N + N / 10;
+            measure(name, "undo", steps, [&](size_t) {
+                history.undoLastAction();
+            });
+            measure(name, "redo", steps, [&](size_t) {
+                history.redoAction();
+            });
+        }
+        unlink(path.c_str());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    for(int i = 1; i < argc; i++)
+        filters.emplace_back(argv[i]);
+
+    char dir[] = "/tmp/minima_bench_XXXXXX";
+    if(!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    for(const Corpus &corpus : CORPORA)
+        if(corpusWanted(corpus.name))
+            runCorpus(corpus, dir);
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,401 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+// Keystroke-to-screen latency, end to end. Runs Minima on a pseudo
+// terminal, types a recorded key trace into it and reads back, for every
+// frame, how long each phase of the main loop took and how many bytes went
+// to the terminal (see FrameLog.h). Run as
+//   minima_replay [-m minima] [-s COLSxROWS] file trace...
+// Each trace gets a fresh Minima on a scratch copy of `file`.
+//
+// A trace is a text file of one step per line:
+//   section NAME       report what follows under NAME
+//   pace MS            leave MS between keys; 0, the default, sends each
+//                      key once the one before it is on screen
+//   type TEXT          each character of TEXT, as is, as a key
+//   key NAME           one of esc enter tab backspace delete up down left
+//                      right home end pgup pgdn wheelup wheeldown ctrl-X
+//   paste TEXT         a bracketed paste, with \n for newlines
+//   sleep MS           wait once everything sent is on screen
+//   repeat N STEP      STEP N times
+// and # starts a comment line.
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // a key nothing answers for this long is given up on
+    constexpr std::chrono::seconds KEY_TIMEOUT{5};
+
+    struct Step {
+        enum Kind {SECTION, PACE, KEY, SLEEP};
+        Kind kind;
+        std::string text; // section name or the key's bytes
+        int ms = 0;
+    };
+
+    const std::map<std::string, std::string> KEYS = {
+        {"esc", "\033"}, {"enter", "\r"}, {"tab", "\t"}, {"backspace", "\177"},
+        {"delete", "\033[3~"}, {"up", "\033OA"}, {"down", "\033OB"}, {"right", "\033OC"},
+        {"left", "\033OD"}, {"home", "\033OH"}, {"end", "\033OF"}, {"pgup", "\033[5~"},
+        {"pgdn", "\033[6~"},
+        // X10 mouse reports of wheel buttons 4 and 5 at the top left
+        {"wheelup", "\033[M`!!"}, {"wheeldown", "\033[Ma!!"},
+    };
+
+    /**
+     * Parse `line` of `trace` onto `steps`, false with a message if it's bad
+     */
+    bool parseStep(const std::string &line, std::vector<Step> &steps, std::string &error) {
+        std::string word = line.substr(0, line.find(' '));
+        std::string rest = word.size() < line.size() ? line.substr(word.size() + 1) : "";
+
+        if(word == "repeat") {
+            size_t count = strtoul(rest.c_str(), nullptr, 10);
+            std::string step = rest.find(' ') != std::string::npos ? rest.substr(rest.find(' ') + 1) : "";
+            std::vector<Step> once;
+            if(!parseStep(step, once, error))
+                return false;
+            for(size_t i = 0; i < count; i++)
+                steps.insert(steps.end(), once.begin(), once.end());
+        } else if(word == "section") {
+            steps.push_back({Step::SECTION, rest});
+        } else if(word == "pace" || word == "sleep") {
+            steps.push_back({word == "pace" ? Step::PACE : Step::SLEEP, "", atoi(rest.c_str())});
+        } else if(word == "type") {
+            for(char c : rest)
+                steps.push_back({Step::KEY, std::string(1, c)});
+        } else if(word == "key") {
+            if(KEYS.count(rest))
+                steps.push_back({Step::KEY, KEYS.at(rest)});
+            else if(rest.size() == 6 && rest.rfind("ctrl-", 0) == 0)
+                steps.push_back({Step::KEY, std::string(1, (char) (rest[5] & 0x1f))});
+            else {
+                error = "unknown key " + rest;
+                return false;
+            }
+        } else if(word == "paste") {
+            std::string text;
+            for(size_t i = 0; i < rest.size(); i++) {
+                if(rest[i] == '\\' && i + 1 < rest.size() && rest[i + 1] == 'n') {
+                    text += '\r';
+                    i++;
+                } else {
+                    text += rest[i];
+                }
+            }
+            steps.push_back({Step::KEY, "\033[200~" + text + "\033[201~"});
+        } else {
+            error = "unknown step " + word;
+            return false;
+        }
+        return true;
+    }
+
+    bool parseTrace(const std::string &path, std::vector<Step> &steps) {
+        std::ifstream in(path);
+        if(!in) {
+            fprintf(stderr, "%s: can't be opened\n", path.c_str());
+            return false;
+        }
+        std::string line, error;
+        for(int number = 1; std::getline(in, line); number++) {
+            if(line.empty() || line[0] == '#')
+                continue;
+            if(!parseStep(line, steps, error)) {
+                fprintf(stderr, "%s:%d: %s\n", path.c_str(), number, error.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char *PHASES[] = {"input", "tick", "scroll", "status", "view", "caret", "refresh"};
+    constexpr int PHASE_COUNT = sizeof PHASES / sizeof *PHASES;
+
+    struct Section {
+        std::string name;
+        std::vector<double> latency;                // ms from sending a key to its frame
+        std::vector<double> phases[PHASE_COUNT];    // ms, per frame that handled keys
+        size_t frames = 0, keys = 0, lost = 0;
+        long long bytes = 0;
+    };
+
+    double percentile(std::vector<double> values, double p) {
+        if(values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        size_t at = (size_t) std::max(0.0, p * (double) values.size() - 1);
+        return values[std::min(at, values.size() - 1)];
+    }
+
+    void report(const Section &section) {
+        printf("%s: %zu keys in %zu frames, %.1f KB to the terminal", section.name.c_str(), section.keys,
+               section.frames, (double) section.bytes / 1024);
+        if(section.lost)
+            printf(", %zu keys never drawn", section.lost);
+        printf("\n  %-10s %10s %10s %10s   ms\n", "", "p50", "p99", "max");
+        auto row = [](const char *name, const std::vector<double> &values) {
+            printf("  %-10s %10.3f %10.3f %10.3f\n", name, percentile(values, 0.5), percentile(values, 0.99),
+                   percentile(values, 1));
+        };
+        row("key", section.latency);
+        for(int phase = 0; phase < PHASE_COUNT; phase++)
+            row(PHASES[phase], section.phases[phase]);
+        printf("\n");
+    }
+
+    /**
+     * One Minima on a pty, with keys going in and frame reports coming out
+     */
+    class Session {
+        pid_t child = -1;
+        int master = -1, frames = -1;
+        bool exited = false;
+        std::string toSend, frameText;
+        std::deque<Clock::time_point> pending; // keys sent and not yet drawn
+        bool started = false;
+        Clock::time_point spawned;
+        std::vector<Section> &sections;
+
+        void onFrame(const std::string &line) {
+            int keys;
+            long long nanos[PHASE_COUNT], bytes;
+            if(sscanf(line.c_str(), "F %d %lld %lld %lld %lld %lld %lld %lld %lld", &keys, &nanos[0], &nanos[1],
+                      &nanos[2], &nanos[3], &nanos[4], &nanos[5], &nanos[6], &bytes) != 9)
+                return;
+            auto now = Clock::now();
+            if(!started) {
+                started = true;
+                printf("startup: first frame after %.1f ms, %.1f KB\n",
+                       std::chrono::duration<double, std::milli>(now - spawned).count(), (double) bytes / 1024);
+                return;
+            }
+            Section &section = sections.back();
+            section.bytes += std::max(0LL, bytes);
+            if(keys == 0)
+                return;
+            section.frames++;
+            for(int phase = 0; phase < PHASE_COUNT; phase++)
+                section.phases[phase].push_back((double) nanos[phase] / 1e6);
+            for(int i = 0; i < keys && !pending.empty(); i++) {
+                section.latency.push_back(std::chrono::duration<double, std::milli>(now - pending.front()).count());
+                pending.pop_front();
+                section.keys++;
+            }
+        }
+
+        /**
+         * Move bytes both ways until `until` or `done()`, whichever is first
+         */
+        void pump(Clock::time_point until, const std::function<bool()> &done) {
+            while(!exited && !done()) {
+                auto now = Clock::now();
+                if(now >= until)
+                    return;
+                if(!pending.empty() && now - pending.front() > KEY_TIMEOUT) {
+                    pending.pop_front();
+                    sections.back().lost++;
+                    continue;
+                }
+
+                pollfd fds[2] = {{master, (short) (POLLIN | (toSend.empty() ? 0 : POLLOUT)), 0},
+                                 {frames, POLLIN, 0}};
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count();
+                if(poll(fds, 2, (int) std::min<long long>(wait + 1, 100)) < 0 && errno != EINTR)
+                    return;
+
+                char buffer[1 << 16];
+                // what Minima draws only needs draining, FrameLog counts it
+                if(fds[0].revents & POLLIN)
+                    (void) read(master, buffer, sizeof buffer);
+                if(fds[0].revents & POLLOUT) {
+                    ssize_t sent = write(master, toSend.data(), toSend.size());
+                    if(sent > 0)
+                        toSend.erase(0, sent);
+                }
+                if(fds[1].revents & (POLLIN | POLLHUP)) {
+                    ssize_t got = read(frames, buffer, sizeof buffer);
+                    if(got <= 0) {
+                        exited = true;
+                        return;
+                    }
+                    frameText.append(buffer, got);
+                    for(size_t end; (end = frameText.find('\n')) != std::string::npos;) {
+                        onFrame(frameText.substr(0, end));
+                        frameText.erase(0, end + 1);
+                    }
+                }
+            }
+        }
+
+    public:
+        explicit Session(std::vector<Section> &sections) : sections(sections) {}
+
+        bool start(const std::string &minima, const std::string &file, int cols, int rows) {
+            int pipeFds[2];
+            if(pipe(pipeFds) != 0) {
+                perror("pipe");
+                return false;
+            }
+            winsize size{(unsigned short) rows, (unsigned short) cols, 0, 0};
+            spawned = Clock::now();
+            child = forkpty(&master, nullptr, nullptr, &size);
+            if(child < 0) {
+                perror("forkpty");
+                return false;
+            }
+            if(child == 0) {
+                close(pipeFds[0]);
+                setenv("TERM", "xterm", 1);
+                setenv("MINIMA_FRAME_FD", std::to_string(pipeFds[1]).c_str(), 1);
+                execl(minima.c_str(), minima.c_str(), file.c_str(), (char *) nullptr);
+                perror(minima.c_str());
+                _exit(127);
+            }
+            close(pipeFds[1]);
+            frames = pipeFds[0];
+            fcntl(master, F_SETFL, O_NONBLOCK);
+
+            pump(Clock::now() + std::chrono::seconds(30), [this] { return started; });
+            if(!started)
+                fprintf(stderr, "%s never drew a frame\n", minima.c_str());
+            return started;
+        }
+
+        void run(const std::vector<Step> &steps) {
+            auto drawn = [this] { return pending.empty() && toSend.empty(); };
+            auto forever = Clock::now() + std::chrono::hours(24);
+            std::chrono::milliseconds pace{0};
+            Clock::time_point lastSent = Clock::now();
+
+            for(const Step &step : steps) {
+                if(exited)
+                    break;
+                switch(step.kind) {
+                    case Step::SECTION:
+                        pump(forever, drawn);
+                        if(sections.back().keys > 0 || sections.back().lost > 0)
+                            sections.emplace_back();
+                        sections.back().name = step.text;
+                        break;
+                    case Step::PACE:
+                        pace = std::chrono::milliseconds(step.ms);
+                        break;
+                    case Step::SLEEP:
+                        pump(forever, drawn);
+                        pump(Clock::now() + std::chrono::milliseconds(step.ms), [] { return false; });
+                        break;
+                    case Step::KEY:
+                        if(pace.count() == 0)
+                            pump(forever, drawn);
+                        else
+                            pump(lastSent + pace, [] { return false; });
+                        lastSent = Clock::now();
+                        pending.push_back(lastSent);
+                        toSend += step.text;
+                        break;
+                }
+            }
+            pump(forever, drawn);
+        }
+
+        ~Session() {
+            if(child > 0) {
+                if(!exited)
+                    kill(child, SIGTERM);
+                waitpid(child, nullptr, 0);
+            }
+            if(master >= 0)
+                close(master);
+            if(frames >= 0)
+                close(frames);
+        }
+    };
+
+    bool copyFile(const std::string &from, const std::string &to) {
+        std::ifstream in(from, std::ios::binary);
+        std::ofstream out(to, std::ios::binary);
+        if(!in || !out)
+            return false;
+        out << in.rdbuf();
+        return (bool) out;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string self = argv[0];
+    std::string minima = self.find('/') != std::string::npos ? self.substr(0, self.rfind('/') + 1) + "Minima"
+                                                              : "Minima";
+    int cols = 120, rows = 40, option;
+    while((option = getopt(argc, argv, "m:s:")) != -1) {
+        if(option == 'm')
+            minima = optarg;
+        else if(option == 's' && sscanf(optarg, "%dx%d", &cols, &rows) == 2)
+            continue;
+        else
+            argc = 0;
+    }
+    if(argc - optind < 2) {
+        fprintf(stderr, "usage: minima_replay [-m minima] [-s COLSxROWS] file trace...\n");
+        return 1;
+    }
+    std::string file = argv[optind];
+    signal(SIGPIPE, SIG_IGN);
+
+    char dir[] = "/tmp/minima_replay_XXXXXX";
+    if(!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    // same name, so the extension picks the same highlighting
+    std::string scratch = std::string(dir) + "/" + file.substr(file.rfind('/') + 1);
+
+    int status = 0;
+    for(int i = optind + 1; i < argc; i++) {
+        std::vector<Step> steps;
+        if(!parseTrace(argv[i], steps) || !copyFile(file, scratch)) {
+            status = 1;
+            continue;
+        }
+        printf("== %s on %s\n", argv[i], file.c_str());
+        std::vector<Section> sections(1);
+        sections[0].name = "trace";
+        {
+            Session session(sections);
+            if(!session.start(minima, scratch, cols, rows)) {
+                status = 1;
+                continue;
+            }
+            session.run(steps);
+        }
+        for(const Section &section : sections)
+            if(section.keys > 0 || section.lost > 0)
+                report(section);
+    }
+    unlink(scratch.c_str());
+    rmdir(dir);
+    return status;
+}
@@ -1,7 +1,8 @@
 #include <iostream>
 #include <ncurses.h>
-#include "Print.h"
 #include "Editor.h"
+#include "Trace.h"
+#include "Log.h"
 
 Editor *editor;
 
@@ -10,9 +11,11 @@ void curses_init()
 {
     initscr();
     raw();
+    noecho(); // only repainted rows get drawn over, so typed keys must not echo
     nonl();
     set_escdelay(50);
     keypad(stdscr, true);
+    idlok(stdscr, true); // lets scrolled text go out as a terminal scroll
 
     if(has_colors()) {
         start_color();
@@ -21,6 +24,12 @@ void curses_init()
     //BUTTON2_PRESSED | BUTTON3_PRESSED
     mousemask(ALL_MOUSE_EVENTS, nullptr);
 
+    // have the terminal mark pasted text so it can go in as one edit
+    define_key("\033[200~", KEY_PASTE_BEGIN);
+    define_key("\033[201~", KEY_PASTE_END);
+    printf("\033[?2004h");
+    fflush(stdout);
+
     init_pair(1, COLOR_WHITE, COLOR_BLUE); // command bar colors
 
     init_color(COLOR_YELLOW, 580, 500, 450);
@@ -29,6 +38,13 @@ void curses_init()
     init_color(COLOR_RED, 1000, 700, 0);
     init_color(COLOR_MAGENTA, 300, 210, 0);
     init_pair(3, COLOR_RED, COLOR_MAGENTA); // line number colors
+
+    init_pair(4, COLOR_BLACK, COLOR_CYAN); // search match colors
+
+    // syntax colors, comments reuse the line number color
+    init_pair(5, COLOR_CYAN, -1);  // keywords and types
+    init_pair(6, COLOR_GREEN, -1); // strings
+    init_pair(7, COLOR_RED, -1);   // numbers and preprocessor
 }
 
 int main(int argc, char* argv[]) {
@@ -39,31 +55,69 @@ int main(int argc, char* argv[]) {
         filename = std::string(argv[1]);
     }
 
+    const char *logPath = getenv("MINIMA_LOG");
+    if(logPath && !logging::open(logPath))
+        fprintf(stderr, "Log %s can't be opened\n", logPath);
+
     editor = new Editor(filename);
     if(!editor->isOpen()) {
-        println("File can't be opened\n");
+        LOG_ERROR("%s can't be opened", filename.c_str());
+        delete editor;
+        logging::close();
+        fprintf(stderr, "%s can't be opened\n", filename.c_str());
         return 1;
     }
+    LOG_INFO("Opened %s", filename.c_str());
+
+    // MINIMA_AUTOSAVE=30 saves after 30 idle seconds, off when unset
+    const char *autosave = getenv("MINIMA_AUTOSAVE");
+    if(autosave)
+        editor->setAutosave(atoi(autosave));
 
     curses_init();
 
+    FrameLog &frames = editor->frameLog();
+    frames.begin();
     editor->printStatusLine();
     editor->printView();
     editor->setCaret();
-    
+    editor->refresh();
+    frames.lap(FrameLog::REFRESH);
+    frames.end(0);
+
     while(editor->isOpen()) {
-        editor->eatInput(getch());
-        editor->updateSelection();
+        timeout(editor->inputTimeout());
+        int key = getch();
+        TRACE_SCOPE("frame");
+        frames.begin();
+        int keys = 0;
+        if(key != ERR)
+            keys = editor->eatKeys(key);
+        frames.lap(FrameLog::INPUT);
+        editor->tick();
+        frames.lap(FrameLog::TICK);
         editor->setScroll();
+        frames.lap(FrameLog::SCROLL);
         editor->printStatusLine();
+        frames.lap(FrameLog::STATUS);
         editor->printView();
+        frames.lap(FrameLog::VIEW);
         editor->setCaret();
+        frames.lap(FrameLog::CARET);
+        editor->refresh();
+        frames.lap(FrameLog::REFRESH);
+        frames.end(keys);
     }
 
-    free(editor);
+    // joins the save and match workers and closes the spill file, so
+    // before the log goes away
+    delete editor;
 
     refresh();
     endwin();
+    printf("\033[?2004l");
+    fflush(stdout);
+    logging::close();
 
     return 0;
 }
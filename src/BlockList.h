@@ -0,0 +1,486 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_BLOCKLIST_H
+#define MINIMA_BLOCKLIST_H
+
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <atomic>
+
+/**
+ * Sequence split into blocks of a few hundred elements, with a Fenwick tree
+ * over the block sizes. Finding an index is O(log blocks), and an insert or
+ * erase only shifts elements inside one block instead of everything after it.
+ *
+ * Blocks are shared between copies and only cloned when one side writes to
+ * them, so copying a BlockList is a cheap snapshot.
+ *
+ * Given a `Weigh` functor (element -> size_t), each block also keeps the sum
+ * of its elements' weights in a second Fenwick tree, so prefix sums of the
+ * weights and finding where a running total is reached cost O(log blocks)
+ * plus a walk inside one block. Weighted elements can't be edited in place;
+ * replace them with set() or change them through modify() so the sums stay
+ * right.
+ */
+template <typename T, typename Weigh = void>
+class BlockList {
+    // blocks split when they grow past 2 * BLOCK and merge when under BLOCK / 4
+    static constexpr size_t BLOCK = 512;
+    static constexpr bool WEIGHTED = !std::is_void_v<Weigh>;
+
+    struct Block {
+        std::vector<T> items;
+        size_t weight = 0; // sum over items, only kept up when WEIGHTED
+    };
+
+    std::vector<std::shared_ptr<Block>> blocks{};
+    std::vector<size_t> tree{};       // fenwick over block sizes, 1-indexed
+    std::vector<size_t> weightTree{}; // fenwick over block weights, when WEIGHTED
+    size_t total = 0;
+
+    static size_t weigh(const T &item) {
+        if constexpr(WEIGHTED)
+            return Weigh{}(item);
+        else
+            return 0;
+    }
+
+    template <typename It>
+    static size_t weighRange(It first, It last) {
+        size_t sum = 0;
+        if constexpr(WEIGHTED)
+            for(; first != last; ++first)
+                sum += weigh(*first);
+        return sum;
+    }
+
+    static std::shared_ptr<Block> makeBlock(std::vector<T> items) {
+        auto block = std::make_shared<Block>();
+        block->items = std::move(items);
+        block->weight = weighRange(block->items.begin(), block->items.end());
+        return block;
+    }
+
+    static void buildFenwick(std::vector<size_t> &fenwick, size_t count, size_t (*value)(const Block &),
+                             const std::vector<std::shared_ptr<Block>> &from) {
+        fenwick.assign(count + 1, 0);
+        for(size_t i = 1; i <= count; i++) {
+            fenwick[i] += value(*from[i - 1]);
+            size_t parent = i + (i & -i);
+            if(parent <= count)
+                fenwick[parent] += fenwick[i];
+        }
+    }
+
+    void rebuildTree() {
+        buildFenwick(tree, blocks.size(), [](const Block &b) { return b.items.size(); }, blocks);
+        if constexpr(WEIGHTED)
+            buildFenwick(weightTree, blocks.size(), [](const Block &b) { return b.weight; }, blocks);
+    }
+
+    void addToTree(size_t block, long delta) {
+        for(size_t i = block + 1; i < tree.size(); i += i & -i)
+            tree[i] += delta;
+    }
+
+    void addWeight(size_t block, long delta) {
+        if constexpr(WEIGHTED) {
+            blocks[block]->weight += delta;
+            for(size_t i = block + 1; i < weightTree.size(); i += i & -i)
+                weightTree[i] += delta;
+        }
+    }
+
+    /**
+     * Writable block, cloned first if a snapshot still shares it
+     */
+    Block &own(size_t block) {
+        auto &ptr = blocks[block];
+        if(ptr.use_count() > 1)
+            ptr = std::make_shared<Block>(*ptr);
+        else
+            // a snapshot on another thread may have just let go of it; make
+            // sure its reads happen before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+        return *ptr;
+    }
+
+    [[nodiscard]]
+    size_t elementsBefore(size_t block) const {
+        size_t sum = 0;
+        for(size_t i = block; i > 0; i -= i & -i)
+            sum += tree[i];
+        return sum;
+    }
+
+    [[nodiscard]]
+    size_t weightBeforeBlock(size_t block) const {
+        size_t sum = 0;
+        for(size_t i = block; i > 0; i -= i & -i)
+            sum += weightTree[i];
+        return sum;
+    }
+
+    /**
+     * Last fenwick position whose prefix stays <= target, and what's left of
+     * target past it
+     */
+    [[nodiscard]]
+    static std::pair<size_t, size_t> descend(const std::vector<size_t> &fenwick, size_t target) {
+        size_t pos = 0, step = 1;
+        while(step * 2 < fenwick.size()) step *= 2;
+        for(; step > 0; step /= 2) {
+            if(pos + step < fenwick.size() && fenwick[pos + step] <= target) {
+                pos += step;
+                target -= fenwick[pos];
+            }
+        }
+        return {pos, target};
+    }
+
+    /**
+     * Block holding element `index`, and the offset inside it.
+     * index == size() maps to one past the end of the last block.
+     */
+    [[nodiscard]]
+    std::pair<size_t, size_t> locate(size_t index) const {
+        if(blocks.empty())
+            return {0, 0};
+        if(index >= total)
+            return {blocks.size() - 1, blocks.back()->items.size() - (total - index)};
+        return descend(tree, index);
+    }
+
+    void splitIfLarge(size_t block) {
+        if(blocks[block]->items.size() <= 2 * BLOCK)
+            return;
+
+        auto &full = own(block).items;
+        std::vector<std::shared_ptr<Block>> pieces;
+        for(size_t i = 0; i < full.size(); i += BLOCK) {
+            size_t end = std::min(full.size(), i + BLOCK);
+            pieces.push_back(makeBlock(std::vector<T>(std::make_move_iterator(full.begin() + i),
+                                                      std::make_move_iterator(full.begin() + end))));
+        }
+        blocks.erase(blocks.begin() + block);
+        blocks.insert(blocks.begin() + block, pieces.begin(), pieces.end());
+        rebuildTree();
+    }
+
+    /**
+     * Move everything in block `from` onto the end of block `into`
+     */
+    void absorb(size_t into, size_t from) {
+        auto &source = own(from);
+        auto &target = own(into);
+        target.items.insert(target.items.end(),
+                            std::make_move_iterator(source.items.begin()),
+                            std::make_move_iterator(source.items.end()));
+        target.weight += source.weight;
+        blocks.erase(blocks.begin() + from);
+    }
+
+    void mergeIfSmall(size_t block) {
+        if(block >= blocks.size() || blocks[block]->items.size() >= BLOCK / 4)
+            return;
+
+        if(blocks[block]->items.empty()) {
+            blocks.erase(blocks.begin() + block);
+        } else if(block + 1 < blocks.size()) {
+            absorb(block, block + 1);
+            splitIfLarge(block);
+        } else if(block > 0) {
+            absorb(block - 1, block);
+            splitIfLarge(block - 1);
+        } else {
+            return; // lone small block, nothing to merge with
+        }
+        rebuildTree();
+    }
+
+public:
+    BlockList() = default;
+
+    explicit BlockList(std::vector<T> items) {
+        assign(std::move(items));
+    }
+
+    void assign(std::vector<T> items) {
+        blocks.clear();
+        for(size_t i = 0; i < items.size(); i += BLOCK) {
+            size_t end = std::min(items.size(), i + BLOCK);
+            blocks.push_back(makeBlock(std::vector<T>(std::make_move_iterator(items.begin() + i),
+                                                      std::make_move_iterator(items.begin() + end))));
+        }
+        total = items.size();
+        rebuildTree();
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return total;
+    }
+
+    [[nodiscard]]
+    bool empty() const {
+        return total == 0;
+    }
+
+    [[nodiscard]]
+    const T &at(size_t index) const {
+        if(index >= total)
+            throw std::out_of_range("BlockList::at");
+        auto [block, offset] = locate(index);
+        return blocks[block]->items[offset];
+    }
+
+    /**
+     * Writable element. Clones its block if a snapshot shares it, so prefer
+     * the const overload for reading.
+     */
+    T &edit(size_t index) {
+        static_assert(!WEIGHTED, "weighted elements are changed with set() or modify()");
+        if(index >= total)
+            throw std::out_of_range("BlockList::edit");
+        auto [block, offset] = locate(index);
+        return own(block).items[offset];
+    }
+
+    void set(size_t index, T item) {
+        if(index >= total)
+            throw std::out_of_range("BlockList::set");
+        auto [block, offset] = locate(index);
+        auto &slot = own(block).items[offset];
+        long delta = (long) weigh(item) - (long) weigh(slot);
+        slot = std::move(item);
+        addWeight(block, delta);
+    }
+
+    /**
+     * Change an element in place with f(element), keeping the weights right
+     */
+    template <typename F>
+    void modify(size_t index, F f) {
+        if(index >= total)
+            throw std::out_of_range("BlockList::modify");
+        auto [block, offset] = locate(index);
+        auto &slot = own(block).items[offset];
+        long before = (long) weigh(slot);
+        f(slot);
+        addWeight(block, (long) weigh(slot) - before);
+    }
+
+    /**
+     * Sum of the weights of every element
+     */
+    [[nodiscard]]
+    size_t totalWeight() const {
+        return weightBeforeBlock(blocks.size());
+    }
+
+    /**
+     * Sum of the weights of the elements before `index`
+     */
+    [[nodiscard]]
+    size_t weightBefore(size_t index) const {
+        if(index >= total)
+            return totalWeight();
+        auto [block, offset] = locate(index);
+        const auto &items = blocks[block]->items;
+        return weightBeforeBlock(block) + weighRange(items.begin(), items.begin() + offset);
+    }
+
+    /**
+     * The element where the running weight passes `target`: the index i with
+     * weightBefore(i) <= target < weightBefore(i + 1), paired with
+     * weightBefore(i). Returns size() if target >= totalWeight().
+     */
+    [[nodiscard]]
+    std::pair<size_t, size_t> findWeight(size_t target) const {
+        if(target >= totalWeight())
+            return {total, totalWeight()};
+        auto [block, rest] = descend(weightTree, target);
+        size_t index = elementsBefore(block), before = target - rest;
+        for(const T &item : blocks[block]->items) {
+            size_t w = weigh(item);
+            if(rest < w)
+                break;
+            rest -= w;
+            before += w;
+            index++;
+        }
+        return {index, before};
+    }
+
+    /**
+     * Calls f on every element in [first, last) in order, walking the blocks
+     * directly instead of looking each index up
+     */
+    template <typename F>
+    void forEach(size_t first, size_t last, F f) const {
+        if(first >= last)
+            return;
+        auto [block, offset] = locate(first);
+        size_t remaining = last - first;
+        for(; remaining > 0 && block < blocks.size(); block++, offset = 0) {
+            const auto &items = blocks[block]->items;
+            for(; offset < items.size() && remaining > 0; offset++, remaining--)
+                f(items[offset]);
+        }
+    }
+
+    /**
+     * Like forEach, but stops as soon as f returns false. Returns the index
+     * it stopped at, or last if it ran through.
+     */
+    template <typename F>
+    size_t forEachWhile(size_t first, size_t last, F f) const {
+        if(first >= last)
+            return last;
+        auto [block, offset] = locate(first);
+        size_t index = first;
+        for(; index < last && block < blocks.size(); block++, offset = 0) {
+            const auto &items = blocks[block]->items;
+            for(; offset < items.size() && index < last; offset++, index++)
+                if(!f(items[offset]))
+                    return index;
+        }
+        return last;
+    }
+
+    /**
+     * Visits [first, last) backwards, from last - 1 down to first, until f
+     * returns false. Returns the index it stopped at, or first - 1.
+     */
+    template <typename F>
+    long forEachReverseWhile(size_t first, size_t last, F f) const {
+        if(first >= last)
+            return (long) first - 1;
+        auto [block, offset] = locate(last - 1);
+        long index = (long) last - 1;
+        while(index >= (long) first) {
+            const auto &items = blocks[block]->items;
+            for(long i = (long) offset; i >= 0 && index >= (long) first; i--, index--)
+                if(!f(items[i]))
+                    return index;
+            if(block == 0)
+                break;
+            block--;
+            offset = blocks[block]->items.size() - 1;
+        }
+        return (long) first - 1;
+    }
+
+    void insert(size_t index, T item) {
+        if(index > total)
+            throw std::out_of_range("BlockList::insert");
+
+        if(blocks.empty()) {
+            blocks.push_back(std::make_shared<Block>());
+            rebuildTree();
+        }
+
+        auto [block, offset] = locate(index);
+        auto &items = own(block).items;
+        size_t w = weigh(item);
+        items.insert(items.begin() + offset, std::move(item));
+        total++;
+        addToTree(block, 1);
+        addWeight(block, (long) w);
+        splitIfLarge(block);
+    }
+
+    template <typename It>
+    void insert(size_t index, It first, It last) {
+        if(index > total)
+            throw std::out_of_range("BlockList::insert");
+
+        if(blocks.empty()) {
+            blocks.push_back(std::make_shared<Block>());
+            rebuildTree();
+        }
+
+        auto [block, offset] = locate(index);
+        auto &items = own(block).items;
+        size_t before = items.size();
+        items.insert(items.begin() + offset, first, last);
+        size_t added = items.size() - before;
+        total += added;
+        addToTree(block, (long) added);
+        addWeight(block, (long) weighRange(items.begin() + offset, items.begin() + offset + added));
+        splitIfLarge(block);
+    }
+
+    /**
+     * Erase elements in [first, last)
+     */
+    void erase(size_t first, size_t last) {
+        eraseInto(first, last, nullptr);
+    }
+
+    /**
+     * Erase elements in [first, last), handing them back moved rather than
+     * destroying them
+     */
+    std::vector<T> extract(size_t first, size_t last) {
+        std::vector<T> out;
+        out.reserve(last > first ? last - first : 0);
+        eraseInto(first, last, &out);
+        return out;
+    }
+
+private:
+    void eraseInto(size_t first, size_t last, std::vector<T> *out) {
+        if(first > last || last > total)
+            throw std::out_of_range("BlockList::erase");
+        if(first == last)
+            return;
+
+        auto [block, offset] = locate(first);
+        size_t remaining = last - first;
+        size_t startBlock = block;
+        bool structural = false;
+
+        while(remaining > 0) {
+            size_t take = std::min(remaining, blocks[block]->items.size() - offset);
+            if(offset == 0 && take == blocks[block]->items.size()) {
+                // whole block goes, no need to shift anything
+                if(out) {
+                    auto &items = own(block).items;
+                    std::move(items.begin(), items.end(), std::back_inserter(*out));
+                }
+                blocks.erase(blocks.begin() + block);
+                structural = true;
+            } else {
+                auto &owned = own(block);
+                auto &items = owned.items;
+                long lost = (long) weighRange(items.begin() + offset, items.begin() + offset + take);
+                if(out)
+                    std::move(items.begin() + offset, items.begin() + offset + take, std::back_inserter(*out));
+                items.erase(items.begin() + offset, items.begin() + offset + take);
+                if(structural) {
+                    owned.weight -= lost; // trees get rebuilt below
+                } else {
+                    addToTree(block, -(long) take);
+                    addWeight(block, -lost);
+                }
+                block++;
+            }
+            remaining -= take;
+            offset = 0;
+        }
+        total -= last - first;
+
+        if(structural)
+            rebuildTree();
+        mergeIfSmall(startBlock);
+    }
+};
+
+#endif //MINIMA_BLOCKLIST_H
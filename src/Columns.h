@@ -0,0 +1,158 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_COLUMNS_H
+#define MINIMA_COLUMNS_H
+
+#include <ncurses.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "LineStorage.h"
+
+/**
+ * Where the bytes of a line land on screen. A tab runs to the next multiple
+ * of TAB, and every other byte takes the cells curses draws it as, like ^X
+ * for a control character. Text goes to curses already expanded, so a row
+ * takes exactly the cells counted here.
+ *
+ * Mapping a screen column walks the line from its start, so lines of
+ * CHECKPOINT bytes or more keep the column of every CHECKPOINT-th byte and
+ * walk from the one before. An edit keeps the ones before the first byte it
+ * changed.
+ */
+class Columns {
+    static constexpr size_t CHECKPOINT = 64 << 10;
+    static constexpr size_t TAB = 8;
+
+    // column of byte k * CHECKPOINT at [k], as far as anything looked
+    mutable std::map<size_t, std::vector<size_t>> longLines{};
+
+    /**
+     * What curses draws for each byte, built on first use since it depends
+     * on the terminal set up by initscr
+     */
+    static const std::array<std::string, 256> &glyphs() {
+        static const std::array<std::string, 256> table = [] {
+            std::array<std::string, 256> made;
+            for(int c = 0; c < 256; c++)
+                made[c] = c == '\t' ? " " : unctrl((chtype) c);
+            return made;
+        }();
+        return table;
+    }
+
+    /**
+     * Checkpoints of `line` from 0 up to the one at or before `at`, or all
+     * of them if the line ends first
+     */
+    const std::vector<size_t> &checkpoints(std::string_view text, size_t line, size_t at) const {
+        std::vector<size_t> &points = longLines[line];
+        if(points.empty())
+            points.push_back(0);
+        size_t last = std::min(at, text.size()) / CHECKPOINT;
+        while(points.size() <= last) {
+            size_t begin = (points.size() - 1) * CHECKPOINT;
+            points.push_back(advance(text, begin, begin + CHECKPOINT, points.back()));
+        }
+        return points;
+    }
+
+    /**
+     * Column after text[begin, end) when it starts at `column`
+     */
+    static size_t advance(std::string_view text, size_t begin, size_t end, size_t column) {
+        for(size_t i = begin; i < end; i++)
+            column += cells((unsigned char) text[i], column);
+        return column;
+    }
+
+public:
+    /**
+     * Cells `c` takes when it starts at `column`
+     */
+    static size_t cells(unsigned char c, size_t column) {
+        return c == '\t' ? TAB - column % TAB : glyphs()[c].size();
+    }
+
+    /**
+     * Append how `c` looks at `column` to `out`
+     */
+    static void draw(std::string &out, unsigned char c, size_t column) {
+        if(c == '\t')
+            out.append(cells(c, column), ' ');
+        else
+            out += glyphs()[c];
+    }
+
+    /**
+     * Column byte `at` of `line` starts at
+     */
+    [[nodiscard]]
+    size_t columnOf(const LineStorage &lines, size_t line, size_t at) const {
+        std::string_view text = lines.at(line).view();
+        at = std::min(at, text.size());
+        if(text.size() < CHECKPOINT)
+            return advance(text, 0, at, 0);
+        size_t k = at / CHECKPOINT;
+        return advance(text, k * CHECKPOINT, at, checkpoints(text, line, at)[k]);
+    }
+
+    /**
+     * The byte of `line` drawn over `column` and the column it starts at,
+     * or the line's length and last column if it ends before that
+     */
+    [[nodiscard]]
+    std::pair<size_t, size_t> byteAt(const LineStorage &lines, size_t line, size_t column) const {
+        std::string_view text = lines.at(line).view();
+        size_t i = 0, at = 0;
+        if(text.size() >= CHECKPOINT) {
+            // columns only grow, so stop adding checkpoints once one is past
+            const std::vector<size_t> *points = &checkpoints(text, line, 0);
+            while(points->back() <= column && points->size() * CHECKPOINT <= text.size())
+                points = &checkpoints(text, line, points->size() * CHECKPOINT);
+            size_t k = std::upper_bound(points->begin(), points->end(), column) - points->begin() - 1;
+            i = k * CHECKPOINT;
+            at = (*points)[k];
+        }
+        for(; i < text.size(); i++) {
+            size_t next = at + cells((unsigned char) text[i], at);
+            if(next > column)
+                break;
+            at = next;
+        }
+        return {i, at};
+    }
+
+    /**
+     * Lines [first, first + removed) were replaced by `added` new ones, the
+     * first `prefix` bytes of the first being as they were
+     */
+    void linesChanged(int first, int removed, int added, size_t prefix = 0) {
+        std::map<size_t, std::vector<size_t>> below;
+        std::vector<size_t> head;
+        for(auto it = longLines.lower_bound(first); it != longLines.end(); it = longLines.erase(it)) {
+            if(it->first == (size_t) first && removed > 0 && added > 0)
+                head = std::move(it->second);
+            else if(it->first >= (size_t) (first + removed))
+                below.emplace(it->first - removed + added, std::move(it->second));
+        }
+        longLines.merge(below);
+        // a checkpoint only depends on the bytes before it
+        head.resize(std::min(head.size(), prefix / CHECKPOINT + 1));
+        if(!head.empty())
+            longLines[first] = std::move(head);
+    }
+
+    void clear() {
+        longLines.clear();
+    }
+};
+
+#endif //MINIMA_COLUMNS_H
@@ -6,8 +6,16 @@
 #define MINIMA_COMMANDS_H
 
 #include <numeric>
+#include <cstring>
 #include "Document.h"
 #include "History.h"
+#include "MatchIndex.h"
+#include "Trace.h"
+#include "Log.h"
+
+// key codes curses reports for the markers terminals put around pasted text
+constexpr int KEY_PASTE_BEGIN = KEY_MAX + 1;
+constexpr int KEY_PASTE_END = KEY_MAX + 2;
 
 struct CommandContext {
 private:
@@ -17,6 +25,8 @@ public:
     enum UNIT {CHAR, WORD, LINE, PARA};
     UNIT unit = WORD;
     std::string literalString;
+    bool regex = false; // literalString was opened with " instead of '
+    SearchOptions searchOptions;
 
     void appendQuantityDigit(char d) {
         quantityStr += d;
@@ -26,6 +36,12 @@ public:
             return std::stoi(quantityStr);
         else return 1; // default
     }
+    // quantity as a byte offset, which can be past what an int holds
+    size_t getOffset() {
+        if (!quantityStr.empty())
+            return std::stoull(quantityStr);
+        else return 0;
+    }
 
     Range getWorkingRange(Document &doc) {
         switch(unit) {
@@ -48,6 +64,7 @@ class Command {
     Document &doc;
     CommandContext context;
     History &history;
+    MatchIndex &matches;
 
     std::string prevCommandChain;
     std::string commandChain;
@@ -56,14 +73,17 @@ class Command {
 
     // state
     bool typingString = false;
+    REQUESTED_ACTION requested = NOTHING; // for actions the editor has to carry out
 
 
 
 public:
-    explicit Command(Document& doc, History &history) : doc(doc), history(history) {}
+    explicit Command(Document& doc, History &history, MatchIndex &matches)
+            : doc(doc), history(history), matches(matches) {}
 
 
     REQUESTED_ACTION eatKey(int key, EditMode mode) {
+        TRACE_SCOPE("Command::eatKey");
 
         // toggle mode
         if(key == 27) { //ESC
@@ -94,12 +114,15 @@ public:
         }else if(mode == COMMAND) {
             if(key == 'q' || key == 'Q')
                 return SAVE;
+            // only keystrokes typed in edit mode fold into one undo step
+            history.seal();
             commandModeCommand(key);
+            history.seal();
         }
 
         // valid use of goto, shut up
         end:
-        return NOTHING;
+        return std::exchange(requested, NOTHING);
     }
 
 
@@ -107,7 +130,9 @@ public:
         auto [ctrlPressed, commandStripped] = controlKey(key);
         bool validCommand = false;
         if(ctrlPressed) {
+            history.seal();
             validCommand = immediateCommands(commandStripped, key);
+            history.seal();
         } else {
             editText(key);
             validCommand = true;
@@ -134,7 +159,8 @@ public:
     }
 
     bool commandChainAdd(char key) {
-        commandChain += letterLowerCase(key);
+        // keep case inside a string being typed
+        commandChain += typingString ? key : letterLowerCase(key);
 
         bool actioned = tryExecCommandChain();
         if(actioned) {
@@ -145,13 +171,16 @@ public:
     }
 
     bool tryExecCommandChain() {
+        TRACE_SCOPE("Command::tryExecCommandChain");
         bool actioned = false;
         context = CommandContext();
+        typingString = false; // worked out again from the whole chain
 
         bool escaped = false;
         for(char key : commandChain) {
-            if(key == '\'') {
+            if(!typingString && (key == '\'' || key == '"')) {
                 typingString = true;
+                context.regex = key == '"';
                 continue;
             }
 
@@ -159,13 +188,19 @@ public:
                 char letter = char(key);
 
                 if(escaped) {
-                    if(key == 'n') {
+                    escaped = false;
+                    if(key == 'c') // search options
+                        context.searchOptions.ignoreCase = true;
+                    else if(key == ' ' || key == '\'' || key == '"')
+                        context.literalString += key;
+                    else if(context.regex) // the regex parser handles its own escapes
+                        context.literalString += std::string("\\") + key;
+                    else if(key == 'n')
                         context.literalString += '\n';
-                        escaped = false;
-                    } else if(key == ' ') {
-                        context.literalString += ' ';
-                        escaped = false;
-                    }
+                    else if(key == '\\')
+                        context.literalString += '\\';
+                    else if(key == 'w')
+                        context.searchOptions.wholeWord = true;
                 } else {
                     if(letter == ' ') {
                         typingString = false;
@@ -236,6 +271,11 @@ public:
                     actioned = true;
                     break;
                 }
+                case 't': { // go to byte offset
+                    doc.setCaret(doc.pointAt(context.getOffset()));
+                    actioned = true;
+                    break;
+                }
                 case 'h': {
                     doc.setCaret(Document::lineStart(doc.caret()));
                     actioned = true;
@@ -252,14 +292,56 @@ public:
                     actioned = true;
                     break;
                 }
+                case 'e': {
+                    requested = WRITE;
+                    actioned = true;
+                    break;
+                }
+                case 'm': { // m toggles frame timings, 'path m writes the trace
+                    actioned = true;
+                    if(context.literalString.empty()) {
+                        requested = TIMINGS;
+                        break;
+                    }
+                    if(!tracing::enabled) {
+                        notify("Built without MINIMA_TRACE");
+                        break;
+                    }
+                    long events = tracing::dump(context.literalString);
+                    if(events < 0)
+                        notify("Trace could not be written to %s", context.literalString.c_str());
+                    else
+                        notify("Wrote %ld trace events to %s", events, context.literalString.c_str());
+                    break;
+                }
                 case 'f': {
                     if(context.literalString.empty()) {
-                        dd("search string is empty");
+                        notify("search string is empty");
+                        break;
+                    }
+                    // step off the caret so repeating with `a` finds the next one
+                    Point from = doc.charOffset(doc.caret(), context.sign);
+                    SearchTerm term{context.literalString, context.regex, context.searchOptions};
+                    std::string error;
+                    if(!matches.setTerm(term, doc.getLines(), error)) {
+                        notify("%s", error.c_str());
+                        actioned = true;
                         break;
                     }
-                    auto search = doc.search(doc.charOffset(doc.caret(), 1), context.literalString, context.sign);
+
+                    std::pair<Range, bool> search = {Range::empty, false};
+                    if(matches.isReady()) {
+                        // counted already, so the next match is a lookup
+                        if(auto hit = matches.step(doc.getLines(), from, context.sign))
+                            search = {hit->first, true};
+                    } else if(context.regex) {
+                        auto regex = Regex::cached(context.literalString, context.searchOptions.ignoreCase, error);
+                        search = doc.searchRegex(from, *regex, context.sign);
+                    } else {
+                        search = doc.search(from, context.literalString, context.sign, context.searchOptions);
+                    }
                     if(!search.second)
-                        dd("Reached end of file");
+                        notify("Reached end of file");
                     else {
                         doc.setSelection(search.first);
                         doc.setCaret(search.first.start);
@@ -359,7 +441,7 @@ public:
                 break;
             }
             case 'v':
-                doc.insertString(copyBuf);
+                replaceSelection(copyBuf);
                 break;
             case 'z':
                 history.undoLastAction();
@@ -400,6 +482,50 @@ public:
         }
     }
 
+    /**
+     * Put `text` in at the caret, over the selection if there is one. The
+     * delete and insert undo as one step.
+     */
+    void replaceSelection(const std::string &text) {
+        doc.beginTransaction();
+        Range selection = doc.getSelection();
+        if(!selection.isEmpty()) {
+            doc.deleteRange(selection);
+            doc.setSelection(Range::empty);
+        }
+        doc.insertString(text);
+        doc.endTransaction();
+    }
+
+    /**
+     * Pasted text goes in as a single edit, so it's one undo step, replacing
+     * the selection if there is one. In command mode it can only go into a
+     * string being typed.
+     */
+    void paste(const std::string &text, EditMode mode) {
+        TRACE_SCOPE("Command::paste");
+        if(text.empty())
+            return;
+        if(mode == EDIT) {
+            history.seal();
+            replaceSelection(text);
+            history.seal();
+        } else if(typingString) {
+            for(char c : text) {
+                if(c == ' ')
+                    commandChain += "\\ ";
+                else if(c == '\n')
+                    commandChain += "\\n";
+                else if(c == '\'' || c == '"')
+                    commandChain += std::string("\\") + c;
+                else if(c == '\\' && !context.regex) // regex escapes are meant as typed
+                    commandChain += "\\\\";
+                else
+                    commandChain += c;
+            }
+        }
+    }
+
     static int letterLowerCase(int letter) {
         // inside [A-Z]
         if (65 <= letter && letter <= 90) {
@@ -416,6 +542,7 @@ public:
     void clearCommands() {
         commandChain.clear();
         context = CommandContext();
+        typingString = false;
     }
 
     void backspace() {
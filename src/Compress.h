@@ -0,0 +1,157 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_COMPRESS_H
+#define MINIMA_COMPRESS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+/**
+ * Small LZ77 block compressor in the LZ4 mould: a hash of the next four
+ * bytes finds an earlier occurrence within 64 KB, and the output is a run
+ * of (literals, back reference) sequences. Fast enough to pack megabytes
+ * of deleted text between keystrokes, and text usually shrinks 2-4x.
+ *
+ * Sequence layout: a token byte with the literal count in the high nibble
+ * and the match length - 4 in the low one, each nibble of 15 continued by
+ * bytes of 255 plus a final byte; then the literals; then a 2 byte little
+ * endian offset and the match, unless the input ends after the literals.
+ */
+namespace compress {
+
+namespace detail {
+
+constexpr int HASH_BITS = 14;
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+
+inline uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline void putLength(std::string &out, size_t length) {
+    for(; length >= 255; length -= 255)
+        out += (char) 255;
+    out += (char) length;
+}
+
+inline void putSequence(std::string &out, std::string_view literals, size_t offset, size_t match) {
+    size_t matchCode = match ? match - MIN_MATCH : 0;
+    out += (char) ((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(matchCode, 15));
+    if(literals.size() >= 15)
+        putLength(out, literals.size() - 15);
+    out += literals;
+    if(!match)
+        return;
+    out += (char) (offset & 0xff);
+    out += (char) (offset >> 8);
+    if(matchCode >= 15)
+        putLength(out, matchCode - 15);
+}
+
+inline size_t getLength(const unsigned char *&p, const unsigned char *end, size_t nibble) {
+    size_t length = nibble;
+    if(nibble == 15) {
+        unsigned char more;
+        do {
+            if(p == end)
+                throw std::runtime_error("compressed block is truncated");
+            more = *p++;
+            length += more;
+        } while(more == 255);
+    }
+    return length;
+}
+
+} // namespace detail
+
+inline std::string pack(std::string_view in) {
+    using namespace detail;
+    std::string out;
+    out.reserve(in.size() / 2 + 16);
+    std::vector<uint32_t> table(1 << HASH_BITS, 0); // position + 1, 0 when empty
+
+    size_t anchor = 0, i = 0;
+    while(i + MIN_MATCH <= in.size()) {
+        uint32_t h = hash(read32(in.data() + i));
+        size_t candidate = table[h];
+        table[h] = (uint32_t) (i + 1);
+
+        if(candidate == 0 || i - (candidate - 1) > MAX_OFFSET
+           || read32(in.data() + candidate - 1) != read32(in.data() + i)) {
+            // skip faster through stretches that don't compress
+            i += 1 + ((i - anchor) >> 6);
+            continue;
+        }
+        candidate--;
+        size_t length = MIN_MATCH;
+        while(i + length < in.size() && in[candidate + length] == in[i + length])
+            length++;
+
+        putSequence(out, in.substr(anchor, i - anchor), i - candidate, length);
+        i += length;
+        anchor = i;
+    }
+    putSequence(out, in.substr(anchor), 0, 0);
+    return out;
+}
+
+/**
+ * Inverse of pack(); `size` is the length of the original text
+ */
+inline std::string unpack(std::string_view in, size_t size) {
+    using namespace detail;
+    std::string out(size, '\0');
+    char *to = out.data(), *full = to + size;
+    auto *p = (const unsigned char *) in.data();
+    auto *end = p + in.size();
+
+    while(p < end) {
+        unsigned char token = *p++;
+        size_t literals = getLength(p, end, token >> 4);
+        if((size_t) (end - p) < literals || (size_t) (full - to) < literals)
+            throw std::runtime_error("compressed block is truncated");
+        memcpy(to, p, literals);
+        to += literals;
+        p += literals;
+        if(p == end)
+            break;
+
+        if(end - p < 2)
+            throw std::runtime_error("compressed block is truncated");
+        size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+        size_t length = getLength(p, end, token & 15) + MIN_MATCH;
+        if(offset == 0 || offset > (size_t) (to - out.data()) || (size_t) (full - to) < length)
+            throw std::runtime_error("compressed block has a bad offset");
+        const char *from = to - offset;
+        if(offset >= length) {
+            memcpy(to, from, length);
+            to += length;
+        } else {
+            // the match overlaps what it's copying, go byte by byte
+            for(size_t k = 0; k < length; k++)
+                *to++ = from[k];
+        }
+    }
+    if(to != full)
+        throw std::runtime_error("compressed block is truncated");
+    return out;
+}
+
+} // namespace compress
+
+#endif //MINIMA_COMPRESS_H
@@ -7,18 +7,53 @@
 
 #include <utility>
 #include <optional>
+#include <functional>
 
 #include "Structure.h"
+#include "LineStorage.h"
+#include "Scan.h"
+#include "Search.h"
+#include "Regex.h"
+#include "WordIndex.h"
+#include "ParagraphIndex.h"
+#include "Trace.h"
 
 class Document {
 private:
-    std::vector<std::string> lines{};
+    LineStorage lines{};
+    WordIndex words{};
+    ParagraphIndex paragraphs{};
     int caretChar = 0, caretLine = 0;
 
     Point selectBegin = {0, 0};
     Point selectEnd = {0, 0};
     bool selecting = false;
 
+    std::vector<std::function<void(const LineChange &)>> lineObservers{};
+
+    // deletes spanning more lines than this move the lines into history
+    // instead of copying their text out
+    static constexpr int BULK_LINES = 64;
+
+    int transactionDepth = 0;
+    bool transactionRecorded = false; // something went into history since the outermost begin
+
+    void record(Action action) {
+        if(transactionDepth > 0) {
+            action.chained = transactionRecorded;
+            action.mergeable = false;
+            transactionRecorded = true;
+        }
+        updateHistory(std::move(action));
+    }
+
+    void linesChanged(const LineChange &change) {
+        words.linesChanged(change.first, change.removed, change.added);
+        paragraphs.linesChanged(change.first, change.removed, change.added);
+        for(auto &observer : lineObservers)
+            observer(change);
+    }
+
     /* Steppers */
 
     [[nodiscard]]
@@ -28,7 +63,7 @@ private:
             // move up a line if possible
             if(curr.line > 0) {
                 curr.line--;
-                curr.chara = (int) lines.at(curr.line).length();
+                curr.chara = (int) lines.at(curr.line).size();
             } else {
                 success = false;
             }
@@ -43,9 +78,9 @@ private:
     [[nodiscard]]
     std::pair<Point, bool> stepRight(Point curr) const {
         bool success = true;
-        if(curr.chara == lines.at(curr.line).length()) {
+        if((size_t) curr.chara == lines.at(curr.line).size()) {
             // move down a line if possible
-            if(curr.line < lines.size() - 1) {
+            if(lines.hasLine(curr.line + 1)) {
                 curr.line++;
                 curr.chara = 0;
             } else {
@@ -68,27 +103,8 @@ private:
         return {curr, true};
     }
 
-    /**
-    * Insert any char, including new line
-    */
-    void insertChar(char insert, Point start) {
-        if(insert == '\n') {
-            auto &currLine = lines.at(start.line);
-            auto rightOfCaret = currLine.substr(start.chara, std::string::npos);
-            currLine.erase(start.chara, std::string::npos);
-            lines.insert(lines.begin() + start.line + 1, rightOfCaret);
-            caretLine += 1;
-            caretChar = 0;
-            return;
-        } else {
-            lines.at(start.line).insert(start.chara, std::string(1, insert));
-            caretChar++;
-        }
-    }
-
     void insertInLine(const std::string& insert, Point start) {
-        auto &line = lines.at(start.line);
-        line.insert(start.chara, insert);
+        lines.edit(start.line, [&](std::string &line) { line.insert(start.chara, insert); });
         caretChar += insert.size();
     }
 
@@ -96,6 +112,27 @@ public:
 
     std::function<void(Action)> updateHistory{};
 
+    /**
+     * Every edit until the matching endTransaction becomes one undo step.
+     * Transactions nest; the outermost pair draws the line.
+     */
+    void beginTransaction() {
+        if(transactionDepth++ == 0)
+            transactionRecorded = false;
+    }
+
+    void endTransaction() {
+        if(transactionDepth > 0)
+            transactionDepth--;
+    }
+
+    /**
+     * Have f called with what changed after every edit
+     */
+    void observeLines(std::function<void(const LineChange &)> f) {
+        lineObservers.push_back(std::move(f));
+    }
+
     /* Related to Highlighting */
     void stopSelection() {
         selecting = false;
@@ -133,8 +170,8 @@ public:
     }
 
     void validifyRange(Range &check) {
-        check.start.line = std::clamp(check.start.line, 0, (int) lines.size() - 1);
-        check.end.line = std::clamp(check.end.line, 0, (int) lines.size() - 1);
+        check.start.line = lines.clampLine(check.start.line);
+        check.end.line = lines.clampLine(check.end.line);
 
         check.start.chara = std::clamp(check.start.chara, 0, (int)lines.at(check.start.line).size());
         check.end.chara = std::clamp(check.end.chara, 0, (int)lines.at(check.end.line).size());
@@ -142,12 +179,18 @@ public:
 
     /* Loose utils */
 
-    const std::vector<std::string> &getLines() {
+    const LineStorage &getLines() {
         return lines;
     }
 
-    void setLines(std::vector<std::string> newLines) {
-        lines = std::move(newLines);
+    /**
+     * Take the text from a mapped file; lines are split off it as needed
+     */
+    void load(std::shared_ptr<FileMap> file) {
+        TRACE_SCOPE("Document::load");
+        lines.load(std::move(file));
+        words.reset();
+        paragraphs.reset();
     }
 
     [[nodiscard]] inline
@@ -174,7 +217,7 @@ public:
 
     [[nodiscard]]
     char charAt(Point p) const {
-        if(lines.at(p.line).length() == p.chara) {
+        if(lines.at(p.line).size() == (size_t) p.chara) {
             return '\n';
         }
 
@@ -182,9 +225,7 @@ public:
     }
 
     void setCaret(Point p) {
-        p.line = std::clamp(p.line,
-                            0,
-                            (int) lines.size() - 1);
+        p.line = lines.clampLine(p.line);
         p.chara = std::clamp(p.chara,
                              0,
                              (int) lines.at(p.line).size());
@@ -197,40 +238,42 @@ public:
     /* Static steppers */
     [[nodiscard]]
     Point charOffset(Point start, int offsetChars) const {
-        int sign = signum(offsetChars);
-        offsetChars = abs(offsetChars);
+        TRACE_SCOPE("Document::charOffset");
+        long target = (long) byteOffset(start) + offsetChars;
+        return pointAt(target < 0 ? 0 : target);
+    }
 
-        std::pair<Point, bool> curr = {start, true};
-        while(offsetChars --> 0) {
-            curr = stepChar(curr.first, sign);
-            if(!curr.second) break;
-        }
+    /**
+     * Bytes from the start of the document to `at`, newlines included
+     */
+    [[nodiscard]]
+    size_t byteOffset(Point at) const {
+        int line = lines.clampLine(at.line);
+        size_t chara = std::clamp(at.chara, 0, (int) lines.at(line).size());
+        return lines.offsetOf(line) + chara;
+    }
 
-        return curr.first;
+    /**
+     * Point `offset` bytes into the document, clamped to its end
+     */
+    [[nodiscard]]
+    Point pointAt(size_t offset) const {
+        auto [line, chara] = lines.lineAtOffset(offset);
+        return {(int) line, (int) chara};
     }
 
+    /**
+     * Move until entering or leaving a word `num` times, skipping whole
+     * lines by their cached word counts
+     */
     [[nodiscard]]
     Point nextCharChange(Point currChar, int num) const {
-        std::pair<Point, bool> runningChar = {currChar, true};
-        bool startState = std::isspace(charAt(currChar));
-
-        // move until exit or enter word
-        int transitions = 0;
-        do {
-            runningChar = stepChar(runningChar.first, num);
-            bool currSpace = isspace(charAt(runningChar.first));
-            if(currSpace != startState) {
-                transitions++;
-                startState = currSpace;
-            }
-            if(!runningChar.second) return runningChar.first;
-        } while(transitions < abs(num));
-
-        return runningChar.first;
+        return words.step(lines, currChar, num);
     }
 
     [[nodiscard]]
     Range wordOffset(Point start, int num) const {
+        TRACE_SCOPE("Document::wordOffset");
         if(num == 0)
             return {start, start};
 
@@ -249,53 +292,33 @@ public:
 
     [[nodiscard]]
     Range lineOffset(Point start, int num) const {
+        TRACE_SCOPE("Document::lineOffset");
         if(num == 0) return {caret(), caret()};
 
         start = {start.line, 0};
 
-        int endLine = start.line + num;
-        endLine = std::clamp(endLine,
-                             0,
-                             (int) lines.size() - 1);
+        int endLine = lines.clampLine(start.line + num);
 
         return Range(start, {endLine, 0});
     }
 
     [[nodiscard]]
     Range paraOffset(Point start, int num) {
+        TRACE_SCOPE("Document::paraOffset");
         if(num == 0) return {caret(), caret()};
 
-        auto validLine = [this](int line){return line >= 0 && line < lines.size();};
-        auto isParagraphHead = [this](int line){
-            if(line <= 0 || line >= lines.size()) return true;
-            auto currLine = lines.at(line), prevLine = lines.at(line-1);
-            return currLine.find(tab) == 0  // start with tab
-                   || std::all_of(prevLine.begin(), prevLine.end(), isspace) // blank line
-                   || prevLine.empty();}; // blank line
-
-        // find start of current paragraph
-        while(start.line > 0 && !isParagraphHead(start.line))
-            start.line--;
-
-        // loop for num of iterations
-        int i = 0, line = start.line;
-        while(validLine(line) && i < num * signum(num)) {
-            line += signum(num);
-            if (isParagraphHead(line))
-                i++;
-        }
-
-        line = std::clamp(line, 0, (int)lines.size()-1);
+        // start of current paragraph
+        start.line = (int) paragraphs.headOf(lines, lines.clampLine(start.line));
 
-        Point end = {line, 0};
+        Point end = {(int) paragraphs.step(lines, start.line, num), 0};
 
         return {start, end};
     }
 
-    static std::string substring(const std::string &in, size_t start, size_t end) {
+    static std::string substring(std::string_view in, size_t start, size_t end) {
         if(start - end == 0)
             return "";
-        return in.substr(start, end - start);
+        return std::string(in.substr(start, end - start));
     }
     static void eraseString(std::string &in, size_t start, size_t end) {
         in.erase(start, end - start);
@@ -303,16 +326,28 @@ public:
 
     /* Bad boy general insert and delete */
     void deleteRange(Range toDelete) {
+        TRACE_SCOPE("Document::deleteRange");
         validifyRange(toDelete);
 
+        if(toDelete.end.line - toDelete.start.line > BULK_LINES) {
+            Action action{Action::DELETE, "", toDelete};
+            action.mergeable = false;
+            action.lines = std::make_shared<LineRun>(takeLines(toDelete));
+            record(std::move(action));
+            return;
+        }
+
         std::string stringToDelete = selectionToString(toDelete);
 
         if(toDelete.start.line == toDelete.end.line) {
-            auto &startLine = lines.at(toDelete.start.line);
-            eraseString(startLine, toDelete.start.chara, toDelete.end.chara);
+            size_t after = lines.at(toDelete.start.line).size() - toDelete.end.chara;
+            lines.edit(toDelete.start.line, [&](std::string &startLine) {
+                eraseString(startLine, toDelete.start.chara, toDelete.end.chara);
+            });
             setCaret(toDelete.start);
+            linesChanged({toDelete.start.line, 1, 1, (size_t) toDelete.start.chara, after});
 
-            updateHistory({
+            record({
                   Action::DELETE,
                   stringToDelete,
                   toDelete
@@ -322,21 +357,21 @@ public:
         }
 
         // Merge lines whose linebreak has been deleted
-        auto &startLine = lines.at(toDelete.start.line);
-        eraseString(startLine, toDelete.start.chara, std::string::npos);
-
-        auto endLine = lines.at(toDelete.end.line);
-        auto endLineRight = endLine.substr(toDelete.end.chara, endLine.size() - toDelete.end.chara);
-
-        startLine += endLineRight;
+        auto endLine = lines.at(toDelete.end.line).view();
+        std::string endLineRight(endLine.substr(toDelete.end.chara));
+        lines.edit(toDelete.start.line, [&](std::string &startLine) {
+            eraseString(startLine, toDelete.start.chara, std::string::npos);
+            startLine += endLineRight;
+        });
 
         // delete the complete lines
         int numToDel = toDelete.end.line - toDelete.start.line;
         if (numToDel > 0)
-            lines.erase(lines.begin() + toDelete.start.line + 1,
-                        lines.begin() + toDelete.end.line + 1);
+            lines.erase(toDelete.start.line + 1, toDelete.end.line + 1);
+        linesChanged({toDelete.start.line, toDelete.end.line - toDelete.start.line + 1, 1,
+                      (size_t) toDelete.start.chara, endLineRight.size()});
 
-        updateHistory({Action::DELETE, stringToDelete, toDelete
+        record({Action::DELETE, stringToDelete, toDelete
         });
 
         setCaret(toDelete.start);
@@ -344,20 +379,44 @@ public:
 
 
     void insertString(const std::string& insert) {
+        TRACE_SCOPE("Document::insertString");
         Point initialCaret = caret();
 
-        size_t pos = 0;
-        while (true) {
-            size_t nextNewline = (int) insert.find('\n', pos);
-            insertInLine(substring(insert, pos, nextNewline), caret());
+        std::vector<std::string_view> pieces;
+        scan::forEachLine(insert, [&pieces](std::string_view piece) {
+            pieces.push_back(piece);
+            return true;
+        });
 
-            if(nextNewline == std::string::npos)
-                break;
-            pos = nextNewline + 1;
-            insertChar('\n', caret());
+        if(pieces.size() == 1) {
+            insertInLine(insert, caret());
+            size_t after = lines.at(caretLine).size() - caretChar;
+            linesChanged({initialCaret.line, 1, 1, (size_t) initialCaret.chara, after});
+        } else {
+            // split the caret line around the insert
+            std::string rightOfCaret;
+            lines.edit(caretLine, [&](std::string &currLine) {
+                rightOfCaret = currLine.substr(caretChar, std::string::npos);
+                currLine.erase(caretChar, std::string::npos);
+                currLine += pieces.front();
+            });
+
+            // and add every new line in one go
+            std::vector<Line> newLines;
+            newLines.reserve(pieces.size() - 1);
+            for(size_t i = 1; i + 1 < pieces.size(); i++)
+                newLines.push_back(lines.pack(pieces[i]));
+            newLines.emplace_back(std::string(pieces.back()) + rightOfCaret);
+            lines.insert(caretLine + 1,
+                         std::make_move_iterator(newLines.begin()),
+                         std::make_move_iterator(newLines.end()));
+
+            caretLine += (int) pieces.size() - 1;
+            caretChar = (int) pieces.back().size();
+            linesChanged({initialCaret.line, 1, (int) pieces.size(), (size_t) initialCaret.chara, rightOfCaret.size()});
         }
 
-        updateHistory({
+        record({
             Action::ADD,
             insert,
             {initialCaret, caret()}
@@ -365,7 +424,85 @@ public:
     }
 
 
+    /**
+     * Delete a range over several lines without recording it, handing back
+     * what went: the tail of the first line, the whole lines in between
+     * moved out as they are, and the head of the last line
+     */
+    LineRun takeLines(Range range) {
+        TRACE_SCOPE("Document::takeLines");
+        validifyRange(range);
+        LineRun taken;
+        taken.reserve(range.end.line - range.start.line + 1);
+        taken.emplace_back(substring(lines.at(range.start.line).view(), range.start.chara, std::string::npos));
+
+        auto endLine = lines.at(range.end.line).view();
+        std::string endLineLeft(substring(endLine, 0, range.end.chara));
+        std::string endLineRight(endLine.substr(range.end.chara));
+        lines.edit(range.start.line, [&](std::string &startLine) {
+            eraseString(startLine, range.start.chara, std::string::npos);
+            startLine += endLineRight;
+        });
+
+        LineRun middle = lines.extract(range.start.line + 1, range.end.line);
+        taken.insert(taken.end(), std::make_move_iterator(middle.begin()), std::make_move_iterator(middle.end()));
+        taken.emplace_back(std::move(endLineLeft));
+        lines.erase(range.start.line + 1, range.start.line + 2);
+
+        linesChanged({range.start.line, range.end.line - range.start.line + 1, 1,
+                      (size_t) range.start.chara, endLineRight.size()});
+        setCaret(range.start);
+        return taken;
+    }
+
+    /**
+     * Put lines from takeLines back at `at` without recording it, leaving
+     * the caret after them
+     */
+    void putLines(Point at, LineRun &&taken) {
+        TRACE_SCOPE("Document::putLines");
+        setCaret(at);
+        std::string rightOfCaret;
+        lines.edit(caretLine, [&](std::string &currLine) {
+            rightOfCaret = currLine.substr(caretChar, std::string::npos);
+            currLine.erase(caretChar, std::string::npos);
+            currLine += taken.front().view();
+        });
+
+        Line &last = taken.back();
+        int lastSize = (int) last.size();
+        if(!rightOfCaret.empty())
+            last.edit() += rightOfCaret;
+        lines.insert(caretLine + 1,
+                     std::make_move_iterator(taken.begin() + 1),
+                     std::make_move_iterator(taken.end()));
+
+        int added = (int) taken.size();
+        taken.clear();
+        linesChanged({at.line, 1, added, (size_t) caretChar, rightOfCaret.size()});
+        caretLine = at.line + added - 1;
+        caretChar = lastSize;
+    }
+
+    /**
+     * The text of lines from takeLines
+     */
+    static std::string joinLines(const LineRun &taken) {
+        size_t size = 0;
+        for(const Line &line : taken)
+            size += line.size() + 1;
+        std::string text;
+        text.reserve(size);
+        for(size_t i = 0; i < taken.size(); i++) {
+            if(i > 0)
+                text += '\n';
+            text += taken[i].view();
+        }
+        return text;
+    }
+
     std::string selectionToString(Range selection){
+        TRACE_SCOPE("Document::selectionToString");
         std::string text;
 
         validifyRange(selection);
@@ -374,48 +511,44 @@ public:
         Point end   = selection.end;
 
         if(start.line == end.line) {
-            text += substring(lines.at(start.line), start.chara, end.chara);
+            text += substring(lines.at(start.line).view(), start.chara, end.chara);
             return text;
         }
         // begin
-        text += substring(lines.at(start.line), start.chara, std::string::npos);
+        text += substring(lines.at(start.line).view(), start.chara, std::string::npos);
         text += '\n';
 
         // mid
-        for(auto it = lines.begin() + start.line + 1;
-            it < lines.begin() + end.line; it++) {
-            text += (*it);
+        lines.forEach(start.line + 1, end.line, [&text](const Line &line) {
+            text += line.view();
             text += '\n';
-        }
+        });
 
         // end
-        text += substring(lines.at(end.line), 0, end.chara);
+        text += substring(lines.at(end.line).view(), 0, end.chara);
 
         return text;
     }
 
-    std::pair<Range, bool> search(Point begin, const std::string &toFind, int direction) {
-        while(true) {
-            Point wordSearch = begin;
-            bool success;
-            for(int letter = 0; letter < toFind.size(); letter++) {
-                if (charAt(wordSearch) != toFind.at(letter))
-                    break; // current position yielded no results
-
-                if(letter == toFind.size() - 1) // all matched
-                    return {{begin, charOffset(begin, toFind.size())}, true};
-
-                // try to advance letter
-                std::tie(wordSearch, success) = stepChar(wordSearch, 1);
-                if(!success) // end of file
-                    return {{wordSearch, wordSearch}, false};
-            }
-
-            // try advance next position
-            std::tie(begin, success) = stepChar(begin, direction);
-            if(!success)
-                return {{begin, begin}, false};
-        }
+    /**
+     * Find toFind starting from `begin`, forwards or backwards.
+     * Returns the match and whether there was one.
+     */
+    std::pair<Range, bool> search(Point begin, const std::string &toFind, int direction,
+                                  SearchOptions options = {}) const {
+        TRACE_SCOPE("Document::search");
+        auto found = TextSearch(toFind, options).find(lines, begin, direction);
+        if(!found)
+            return {{begin, begin}, false};
+        return {*found, true};
+    }
+
+    std::pair<Range, bool> searchRegex(Point begin, const Regex &regex, int direction) const {
+        TRACE_SCOPE("Document::searchRegex");
+        auto found = regex.find(lines, begin, direction);
+        if(!found)
+            return {{begin, begin}, false};
+        return {*found, true};
     }
 };
 
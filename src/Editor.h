@@ -8,6 +8,16 @@
 #include "Document.h"
 #include "Commands.h"
 #include "History.h"
+#include "FileWriter.h"
+#include "SaveWorker.h"
+#include "MatchIndex.h"
+#include "ScreenDamage.h"
+#include "OutputMeter.h"
+#include "FrameLog.h"
+#include "Highlighter.h"
+#include "Columns.h"
+#include "Trace.h"
+#include "Log.h"
 
 #include <fstream>
 #include <iostream>
@@ -16,67 +26,137 @@
 #include <cmath>
 #include <bitset>
 #include <utility>
+#include <chrono>
 
 class Editor {
 private:
     std::string filename;
 
     Document document;
+    MatchIndex matches;
+    Highlighter highlighter;
+    Columns columns;
     Command command;
     History history;
 
     bool open = true;
 
+    // save in the background after this long without input, 0 turns it off
+    int autosaveSeconds = 0;
+
+    // undo text kept in memory before the oldest gets compressed and spilled to disk
+    static constexpr size_t HISTORY_BUDGET = 64 << 20;
+
+    SaveWorker saver;
+    long version = 0, savedVersion = 0; // bumped on every edit
+    std::chrono::steady_clock::time_point lastInput = std::chrono::steady_clock::now();
+
+    // draw at most this often while keys keep arriving, and at least this
+    // often when each key takes a while to handle
+    static constexpr std::chrono::milliseconds FRAME_INTERVAL{16};
+    static constexpr std::chrono::milliseconds MAX_BATCH{100};
+    std::chrono::steady_clock::time_point lastFrame{};
+
+    // how long a paste can stall before it's taken as finished
+    static constexpr int PASTE_TIMEOUT_MS = 500;
+
     int scroll = 0;
+    int hscroll = 0; // first screen column of text on screen, the same for every line
     int gutterSize = 0;
 
+    // what's on screen now, so a frame only repaints what changed
+    ScreenDamage damage;
+    int drawnCaretLine = -1;
+    Range drawnSelection = Range::empty;
+    long drawnSearch = -1;
+    std::string drawnStatus;
+    OutputMeter meter;
+    FrameLog frames;
+
     EditMode mode = COMMAND;
 public:
     explicit Editor(const std::string& filename)
-                : filename(filename), history(document), command(document, history){
-
-        std::ifstream infile(filename.c_str());
-        if(infile.is_open()) {
-            // read the file to document
-            std::vector<std::string> allLines{};
-            while (!infile.eof()) {
-                std::string line;
-                getline(infile, line);
-                allLines.push_back(line);
-            }
-            document.setLines(std::move(allLines));
-        } else {
+                : filename(filename), history(document, HISTORY_BUDGET), command(document, history, matches){
+
+        // map the file; lines get split off it as the view reaches them
+        auto file = FileMap::open(filename);
+        if(file)
+            document.load(std::move(file));
+        else
             open = false;
-        }
-        infile.close();
 
-        document.updateHistory = [this](Action action){history.addAction(std::move(action));};
+        document.updateHistory = [this](Action action){
+            version++;
+            history.addAction(std::move(action));
+        };
+        highlighter.setLanguage(lex::forFile(filename));
+
+        document.observeLines([this](const LineChange &change) {
+            auto [first, removed, added, prefix, suffix] = change;
+            matches.linesChanged(document.getLines(), first, removed, added);
+            columns.linesChanged(first, removed, added, prefix);
+            if(removed == added)
+                damage.markLines(first, first + added);
+            else
+                damage.markFrom(first); // everything below moved
+
+            // lines whose highlighting an edit above carried over to
+            size_t settled = highlighter.linesChanged(document.getLines(), first, removed, added, prefix, suffix);
+            if(settled == SIZE_MAX)
+                damage.markFrom(first);
+            else
+                damage.markLines(first, (int) settled);
+        });
     }
 
     void printStatusLine() {
         int screenHeight = getmaxy(stdscr);
+        int screenWidth = getmaxx(stdscr);
         std::string statusMessage;
         if(mode == COMMAND) {
             statusMessage += " Command: ";
             statusMessage += command.getCommandChain();
         }
-
-        // command bar
-        if(mode == COMMAND) attron(COLOR_PAIR(1));
-        mvprintw(screenHeight - 1, 0, (statusMessage + getStatus() + " ").c_str());
-        clrtoeol();
-        if(mode == COMMAND) attroff(COLOR_PAIR(1));
+        statusMessage += getStatus();
+        statusMessage += " ";
 
         // line stats
         auto[line, chara] = document.caret();
         std::string lineStats;
+        std::string found = matches.describe(document.getLines(), document.caret());
+        if(!found.empty())
+            lineStats += found + "    ";
+        std::string undo = history.describeMemory();
+        if(!undo.empty())
+            lineStats += undo + "    ";
+        std::string sent = meter.describe();
+        if(!sent.empty())
+            lineStats += sent + "    ";
+        std::string timing = frames.describe();
+        if(!timing.empty())
+            lineStats += timing + "    ";
         lineStats += (document.isSelecting() ? "select    " : "");
         lineStats += std::to_string(line) + ":" + std::to_string(chara);
-        int screenWidth = getmaxx(stdscr);
-        mvprintw(screenHeight - 1, screenWidth - (int)lineStats.size() - 3, lineStats.c_str());
+
+        // skip the terminal entirely when nothing on the bar changed
+        std::string status = std::to_string(mode) + std::to_string(screenHeight) + "x" + std::to_string(screenWidth)
+                             + "\n" + statusMessage + "\n" + lineStats;
+        if(status == drawnStatus)
+            return;
+        drawnStatus = std::move(status);
+
+        // command bar
+        if(mode == COMMAND) attron(COLOR_PAIR(1));
+        mvaddstr(screenHeight - 1, 0, statusMessage.c_str());
+        clrtoeol();
+        if(mode == COMMAND) attroff(COLOR_PAIR(1));
+
+        mvaddstr(screenHeight - 1, screenWidth - (int)lineStats.size() - 3, lineStats.c_str());
     }
 
     static std::string padLeft(std::string s, int width) {
+        if(width <= (int) s.length())
+            return s;
         return s.insert(0, width - s.length(), ' ');
     }
 
@@ -89,89 +169,184 @@ public:
         return in.substr(start, end - start);
     }
 
-    void printView() {
-        Range selection = document.getSelection();
+    /**
+     * How a kind of token looks, see curses_init for the colors
+     */
+    static attr_t styleOf(lex::Kind kind) {
+        switch(kind) {
+            case lex::KEYWORD:  return COLOR_PAIR(5) | A_BOLD;
+            case lex::TYPE:     return COLOR_PAIR(5);
+            case lex::KEY:      return COLOR_PAIR(5);
+            case lex::STRING:   return COLOR_PAIR(6);
+            case lex::CODE:     return COLOR_PAIR(6);
+            case lex::NUMBER:   return COLOR_PAIR(7);
+            case lex::PREPROC:  return COLOR_PAIR(7);
+            case lex::COMMENT:  return COLOR_PAIR(2);
+            case lex::HEADING:  return COLOR_PAIR(5) | A_BOLD;
+            case lex::EMPHASIS: return A_BOLD;
+            default:            return A_NORMAL;
+        }
+    }
 
-        int screenHeight = getmaxy(stdscr) - 1; // save a line for status bar
-        auto &lines = document.getLines();
+    /**
+     * Print text at (y, x), switching attributes wherever they change
+     */
+    static void printRuns(int y, int x, const std::string &text, const std::vector<attr_t> &attrs) {
+        move(y, x);
+        for(size_t i = 0; i < text.size();) {
+            size_t end = i;
+            while(end < text.size() && attrs[end] == attrs[i]) end++;
+            attron(attrs[i]);
+            addnstr(text.data() + i, (int) (end - i));
+            attroff(attrs[i]);
+            i = end;
+        }
+    }
 
-        int screenLine = 0, documentLine = int(scroll);
-        for(; documentLine < lines.size() && screenLine < screenHeight;
-              documentLine++, screenLine++) {
-
-            // line number
-            if(document.line() == documentLine) attron(COLOR_PAIR(3) | A_BOLD);
-            else                                attron(COLOR_PAIR(2));
-
-            std::string row = padLeft(std::to_string(documentLine), (int)ceil(std::log10(lines.size())));
-            row += " ";
-            mvprintw(screenLine, 0, row.c_str());
-            attroff(COLOR_PAIR(2));
-
-            if(document.line() == documentLine) attroff(COLOR_PAIR(3) | A_BOLD);
-            else                                attroff(COLOR_PAIR(2));
-
-            row += " ";
-
-            // actual text
-            gutterSize = (int)row.size();
-            std::string fulltext = lines.at(documentLine);
-
-            // at selection start or end
-            if(selection.start.line == selection.end.line) {
-                if (documentLine == selection.start.line) {
-                    std::string first = sub(fulltext, 0, selection.start.chara);
-                    std::string second = sub(fulltext, selection.start.chara, selection.end.chara);
-                    std::string third = sub(fulltext, selection.end.chara, fulltext.size());
-                    mvprintw(screenLine, gutterSize, first.c_str());
-                    attron(A_REVERSE);
-                    mvprintw(screenLine, gutterSize + first.size(), second.c_str());
-                    attroff(A_REVERSE);
-                    mvprintw(screenLine, gutterSize + first.size() + second.size(), third.c_str());
-                } else {
-                    mvprintw(screenLine, gutterSize, fulltext.c_str());
-                }
-            }
-            // highlight for second part
-            else if (documentLine == selection.start.line) {
-                std::string first = sub(fulltext, 0, selection.start.chara);
-                std::string second = sub(fulltext, selection.start.chara, fulltext.size());
-                mvprintw(screenLine, gutterSize, first.c_str());
-                attron(A_REVERSE);
-                mvprintw(screenLine, gutterSize + first.size(), second.c_str());
-                attroff(A_REVERSE);
-            }
-            // highlight for first part
-            else if(documentLine == selection.end.line) {
-                std::string first = sub(fulltext, 0, selection.end.chara);
-                std::string second = sub(fulltext, selection.end.chara, fulltext.size());
-                attron(A_REVERSE);
-                mvprintw(screenLine, gutterSize, first.c_str());
-                attroff(A_REVERSE);
-                mvprintw(screenLine, gutterSize + first.size(), second.c_str());
-            }
-            // highlight whole thing
-            else if(selection.start.line < documentLine && documentLine < selection.end.line) {
-                attron(A_REVERSE);
-                mvprintw(screenLine, gutterSize, fulltext.c_str());
-                attroff(A_REVERSE);
-            }
-            // highlight nothing
-            else {
-                mvprintw(screenLine, gutterSize, fulltext.c_str());
-            }
+    /**
+     * Move the rows already drawn up by `shift` (down if negative), leaving
+     * the status bar alone. With idlok on, curses sends this as a terminal
+     * scroll, so only the rows that come into view get sent.
+     */
+    static void scrollText(int shift, int screenHeight) {
+        setscrreg(0, screenHeight - 1);
+        scrollok(stdscr, true);
+        scrl(shift);
+        scrollok(stdscr, false);
+        setscrreg(0, getmaxy(stdscr) - 1);
+    }
 
-//            int screenWidth = getmaxx(stdscr);
-//            int currX = gutterSize + fulltext.size();
-//            mvprintw(screenLine, currX, std::string(screenWidth - currX, ' ').c_str());
-            clrtoeol();
+    /**
+     * Figure out which rows changed since the last frame: the caret line's
+     * gutter, the lines the selection grew or shrank over, and everything
+     * if the search term or the gutter width changed
+     */
+    void collectDamage(int screenHeight, int newGutter) {
+        int shift = damage.frame(scroll, screenHeight, getmaxx(stdscr));
+        if(shift != 0)
+            scrollText(shift, screenHeight);
+
+        if(newGutter != gutterSize) {
+            gutterSize = newGutter;
+            damage.markAll();
+        }
+        if(matches.generation() != drawnSearch) {
+            drawnSearch = matches.generation();
+            damage.markAll();
+        }
+
+        int caretLine = document.line();
+        if(caretLine != drawnCaretLine) {
+            damage.markLines(drawnCaretLine, drawnCaretLine + 1);
+            damage.markLines(caretLine, caretLine + 1);
+            drawnCaretLine = caretLine;
+        }
+
+        // lines that changed selection state all sit between the old and
+        // new start, or between the old and new end
+        Range selection = document.getSelection();
+        auto span = [this](int a, int b) { damage.markLines(std::min(a, b), std::max(a, b) + 1); };
+        if(selection.start != drawnSelection.start || selection.end != drawnSelection.end) {
+            span(selection.start.line, drawnSelection.start.line);
+            span(selection.end.line, drawnSelection.end.line);
+            drawnSelection = selection;
         }
+    }
+
+    void printLine(int screenLine, int documentLine, Range selection) {
+        auto &lines = document.getLines();
 
-        for(; screenLine < screenHeight; screenLine++) {
-            move(screenLine, 0);
+        // line number
+        if(document.line() == documentLine) attron(COLOR_PAIR(3) | A_BOLD);
+        else                                attron(COLOR_PAIR(2));
+
+        std::string row = padLeft(std::to_string(documentLine), gutterSize - 2);
+        row += " ";
+        mvaddstr(screenLine, 0, row.c_str());
+        attroff(COLOR_PAIR(2));
+
+        if(document.line() == documentLine) attroff(COLOR_PAIR(3) | A_BOLD);
+        else                                attroff(COLOR_PAIR(2));
+        addch(' ');
+
+        // only the bytes drawn over the columns that fit on screen
+        std::string_view fulltext = lines.at(documentLine).view();
+        int width = std::max(0, getmaxx(stdscr) - gutterSize);
+        auto [begin, beginColumn] = columns.byteAt(lines, documentLine, hscroll);
+        int from = (int) begin;
+        int to = from;
+        size_t column = beginColumn;
+        while(to < (int) fulltext.size() && column < (size_t) (hscroll + width))
+            column += Columns::cells((unsigned char) fulltext[to++], column);
+        std::string_view text = fulltext.substr(from, to - from);
+
+        std::vector<attr_t> attrs(text.size(), A_NORMAL);
+        for(auto token : highlighter.tokens(lines, documentLine, from, to))
+            for(int i = std::max((int) token.start, from); i < std::min((int) token.end, to); i++)
+                attrs[i - from] = styleOf(token.kind);
+        for(auto [start, end] : matches.onLine(lines, documentLine, from, to))
+            for(int i = std::max(start, from); i < std::min(end, to); i++)
+                attrs[i - from] = (attrs[i - from] & ~A_COLOR) | COLOR_PAIR(4);
+
+        // selected part of this line
+        int selectFrom = -1, selectTo = -1;
+        if(selection.start.line <= documentLine && documentLine <= selection.end.line) {
+            selectFrom = documentLine == selection.start.line ? selection.start.chara : 0;
+            selectTo = documentLine == selection.end.line ? selection.end.chara : (int) fulltext.size();
+        }
+        for(int i = std::max(selectFrom, from); i < std::min(selectTo, to); i++)
+            attrs[i - from] |= A_REVERSE;
+
+        // tabs and control characters expanded, cut to the columns on screen
+        std::string shown;
+        std::vector<attr_t> shownAttrs;
+        for(size_t i = 0; i < text.size(); i++) {
+            Columns::draw(shown, (unsigned char) text[i], beginColumn + shown.size());
+            shownAttrs.resize(shown.size(), attrs[i]);
+        }
+        // a tab or ^X that hscroll lands inside starts left of the screen
+        size_t skip = std::min(shown.size(), (size_t) hscroll - beginColumn);
+        shown = shown.substr(skip, width);
+        shownAttrs = std::vector<attr_t>(shownAttrs.begin() + (long) skip, shownAttrs.begin() + (long) (skip + shown.size()));
+
+        printRuns(screenLine, gutterSize, shown, shownAttrs);
+        // a full row leaves the cursor on the next one, nothing to clear
+        if((int) shown.size() < width)
             clrtoeol();
+    }
+
+    void printView() {
+        TRACE_SCOPE("Editor::printView");
+        int screenHeight = getmaxy(stdscr) - 1; // save a line for status bar
+        auto &lines = document.getLines();
+
+        // as many digits as the last known line number needs, plus two spaces
+        int digits = 0;
+        for(size_t n = 1; n < lines.knownSize(); n *= 10)
+            digits++;
+        collectDamage(screenHeight, digits + 2);
+
+        Range selection = document.getSelection();
+        for(int screenLine = 0; screenLine < screenHeight; screenLine++) {
+            if(!damage.isDirty(screenLine))
+                continue;
+            int documentLine = scroll + screenLine;
+            if(lines.hasLine(documentLine)) {
+                printLine(screenLine, documentLine, selection);
+            } else {
+                move(screenLine, 0);
+                clrtoeol();
+            }
         }
+        damage.clear();
+    }
 
+    /**
+     * Send the frame to the terminal
+     */
+    void refresh() {
+        meter.refresh();
+        lastFrame = std::chrono::steady_clock::now();
     }
 
     void setScroll() {
@@ -189,6 +364,15 @@ public:
 
         if (caretScreenLine > largerMargin)
             scrollBy(caretScreenLine - largerMargin);
+
+        // sideways, jump to put the caret mid screen once it leaves it,
+        // so a long line repaints every half screen instead of every key
+        int width = std::max(1, getmaxx(stdscr) - gutterSize);
+        int column = (int) columns.columnOf(document.getLines(), caretPos.line, caretPos.chara);
+        if(column < hscroll || column >= hscroll + width) {
+            hscroll = std::max(0, column - width / 2);
+            damage.markAll();
+        }
     }
 
     void scrollBy(int delta) {
@@ -196,8 +380,12 @@ public:
 
         scroll += delta;
 
+        // only look as far down as the bottom of the screen, the rest of
+        // the file may not be indexed yet
+        int lastLine = document.getLines().clampLine(scroll + screenHeight - 1);
+
         int minScroll = 0;
-        int maxScroll = int(document.getLines().size()) - screenHeight;
+        int maxScroll = lastLine + 1 - screenHeight;
         if(maxScroll < 0) maxScroll = 0;
 
         if (scroll < minScroll) scroll = minScroll;
@@ -207,23 +395,129 @@ public:
 
     void setCaret() {
         auto caretPos = document.caret();
-        move(caretPos.line - scroll, gutterSize + caretPos.chara);
+        int column = (int) columns.columnOf(document.getLines(), caretPos.line, caretPos.chara);
+        move(caretPos.line - scroll, gutterSize + column - hscroll);
 
     }
     void eatInput(int key) {
         setStatus("");
+        lastInput = std::chrono::steady_clock::now();
+
+        if(key == KEY_PASTE_BEGIN) {
+            command.paste(readPaste(), mode);
+            return;
+        }
 
         REQUESTED_ACTION req = command.eatKey(key, mode);
         if(req == TOCMD)
             mode = COMMAND;
         if(req == TOEDIT)
             mode = EDIT;
+        if(req == WRITE)
+            saveInBackground();
+        if(req == TIMINGS)
+            frames.toggleOverlay();
         if(req == SAVE) {
-            save();
-            open = false;
+            // stay open if the file couldn't be written
+            if(save())
+                open = false;
+        }
+    }
+
+    /**
+     * The rest of a bracketed paste, up to its end marker. Gives up if the
+     * terminal goes quiet without sending one.
+     */
+    static std::string readPaste() {
+        std::string text;
+        timeout(PASTE_TIMEOUT_MS);
+        int previous = ERR;
+        for(int key = getch(); key != ERR && key != KEY_PASTE_END; key = getch()) {
+            if(key == 13)
+                text += '\n';
+            else if(key == 10 && previous != 13) // \r\n is one newline
+                text += '\n';
+            else if(key < 256 && key != 10 && key != 27)
+                text += (char) key;
+            previous = key;
+        }
+        return text;
+    }
+
+    /**
+     * Eat `key` and whatever else arrives before the next frame is due, so
+     * key repeat, wheel bursts and pasted text get one repaint per batch
+     * instead of one per key. Returns how many keys that was.
+     */
+    int eatKeys(int key) {
+        auto start = std::chrono::steady_clock::now();
+        int eaten = 0;
+        while(true) {
+            eatInput(key);
+            updateSelection();
+            eaten++;
+            if(!open)
+                return eaten;
+
+            auto now = std::chrono::steady_clock::now();
+            if(now - start >= MAX_BATCH)
+                return eaten;
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(lastFrame + FRAME_INTERVAL - now);
+            timeout(std::max(0, (int) wait.count()));
+            key = getch();
+            if(key == ERR)
+                return eaten;
         }
     }
 
+    /**
+     * Work that happens between keys: picking up the match count, background
+     * save progress and autosave
+     */
+    void tick() {
+        matches.poll(document.getLines());
+
+        if(auto done = saver.poll()) {
+            auto [report, snapshotVersion] = *done;
+            if(report.ok)
+                savedVersion = snapshotVersion;
+            logSave(report);
+            setStatus(report.describe());
+        } else if(saver.busy()) {
+            setStatus(saver.describeProgress());
+        }
+
+        auto idle = std::chrono::steady_clock::now() - lastInput;
+        if(autosaveSeconds > 0 && !saver.busy() && version != savedVersion
+           && idle >= std::chrono::seconds(autosaveSeconds))
+            saveInBackground();
+    }
+
+    /**
+     * How long getch should wait for a key, in ms; -1 blocks. Only wakes up
+     * periodically when tick() has something to do.
+     */
+    [[nodiscard]]
+    int inputTimeout() const {
+        if(saver.busy() || matches.busy() || autosaveSeconds > 0)
+            return 100;
+        return -1;
+    }
+
+    /**
+     * Save in the background after `seconds` without input, 0 for never
+     */
+    void setAutosave(int seconds) {
+        autosaveSeconds = std::max(0, seconds);
+    }
+
+    /**
+     * Phase timings of the main loop, which main.cpp takes
+     */
+    FrameLog &frameLog() {
+        return frames;
+    }
+
     [[nodiscard]]
     bool isOpen() const {
         return open;
@@ -232,21 +526,32 @@ public:
         open = false;
     }
 
-    void save() {
-        // get text with newlines
-        auto &lines = document.getLines();
-        std::string fullText;
-        for(const auto& line : lines) {
-            fullText += line;
-            fullText += '\n';
-        }
-        // remove last newline
-        fullText.pop_back();
-
-        std::ofstream out;
-        out.open(filename);
-        out << fullText;
-        out.close();
+    bool save() {
+        TRACE_SCOPE("Editor::save");
+        saver.wait();
+        SaveReport report = FileWriter::save(filename, document.getLines());
+        logSave(report);
+        setStatus(report.describe());
+        if(report.ok)
+            savedVersion = version;
+        return report.ok;
+    }
+
+    void logSave(const SaveReport &report) {
+        if(report.ok)
+            LOG_INFO("Saved %s: %s", filename.c_str(), report.describe().c_str());
+        else
+            LOG_WARN("Saving %s failed: %s", filename.c_str(), report.describe().c_str());
+    }
+
+    void saveInBackground() {
+        if(saver.busy()) {
+            notify("Already saving");
+            return;
+        }
+        // copying the storage only copies block pointers
+        saver.start(filename, document.getLines(), version);
+        setStatus(saver.describeProgress());
     }
 
 };
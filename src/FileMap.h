@@ -0,0 +1,90 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_FILEMAP_H
+#define MINIMA_FILEMAP_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Trace.h"
+
+/**
+ * Read-only view of a whole file. Regular files are mmapped so nothing is
+ * copied until a page is actually touched; anything mmap refuses (empty
+ * files, pipes) is read into a heap buffer instead.
+ */
+class FileMap {
+    const char *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string fallback;
+
+    FileMap() = default;
+
+public:
+    FileMap(const FileMap &) = delete;
+    FileMap &operator=(const FileMap &) = delete;
+
+    ~FileMap() {
+        if(mapped)
+            munmap((void *) bytes, length);
+    }
+
+    /**
+     * Returns nullptr if the file can't be opened
+     */
+    static std::shared_ptr<FileMap> open(const std::string &path) {
+        TRACE_SCOPE("FileMap::open");
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return nullptr;
+
+        std::shared_ptr<FileMap> file(new FileMap());
+
+        struct stat info{};
+        if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(addr != MAP_FAILED) {
+                file->bytes = (const char *) addr;
+                file->length = info.st_size;
+                file->mapped = true;
+            }
+        }
+        close(fd);
+
+        if(!file->mapped) {
+            std::ifstream in(path, std::ios::binary);
+            if(!in.is_open())
+                return nullptr;
+            std::stringstream buffer;
+            buffer << in.rdbuf();
+            file->fallback = buffer.str();
+            file->bytes = file->fallback.data();
+            file->length = file->fallback.size();
+        }
+
+        return file;
+    }
+
+    [[nodiscard]]
+    std::string_view view() const {
+        return {bytes, length};
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return length;
+    }
+};
+
+#endif //MINIMA_FILEMAP_H
@@ -0,0 +1,161 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_FILEWRITER_H
+#define MINIMA_FILEWRITER_H
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "LineStorage.h"
+#include "Trace.h"
+
+struct SaveReport {
+    bool ok = false;
+    size_t bytes = 0;
+    double seconds = 0;
+    std::string error;
+
+    /**
+     * One line summary for the status bar
+     */
+    [[nodiscard]]
+    std::string describe() const {
+        if(!ok)
+            return "Save failed: " + error;
+        double mb = (double) bytes / 1e6;
+        double rate = seconds > 0 ? mb / seconds : 0;
+        char buf[96];
+        snprintf(buf, sizeof buf, "Saved %.1f MB in %.3fs (%.0f MB/s)", mb, seconds, rate);
+        return buf;
+    }
+};
+
+/**
+ * Streams lines to a temp file next to the target with batched writev,
+ * fsyncs it, then renames it over the target. The original is never
+ * truncated, so a crash mid-save leaves it intact. Renaming also keeps the
+ * old inode alive for any mapping still pointing into it.
+ */
+class FileWriter {
+    static constexpr int BATCH = 1024; // iovecs per writev, well under IOV_MAX
+
+    int fd;
+    iovec pending[BATCH]{};
+    int pendingCount = 0;
+    size_t written = 0;
+    int error = 0;
+    std::atomic<size_t> *progress;
+
+    FileWriter(int fd, std::atomic<size_t> *progress) : fd(fd), progress(progress) {}
+
+    void flush() {
+        iovec *vec = pending;
+        int count = pendingCount;
+        while(count > 0 && !error) {
+            ssize_t n = writev(fd, vec, count);
+            if(n < 0) {
+                if(errno == EINTR) continue;
+                error = errno;
+                break;
+            }
+            written += n;
+            // skip past whatever the kernel took, it may stop mid-buffer
+            while(count > 0 && (size_t) n >= vec->iov_len) {
+                n -= (ssize_t) vec->iov_len;
+                vec++;
+                count--;
+            }
+            if(count > 0) {
+                vec->iov_base = (char *) vec->iov_base + n;
+                vec->iov_len -= n;
+            }
+        }
+        pendingCount = 0;
+        if(progress)
+            progress->store(written, std::memory_order_relaxed);
+    }
+
+    void add(std::string_view span) {
+        if(span.empty())
+            return;
+        pending[pendingCount++] = {(void *) span.data(), span.size()};
+        if(pendingCount == BATCH)
+            flush();
+    }
+
+public:
+    /**
+     * If given, `progress` is kept up to date with the bytes written so far
+     */
+    static SaveReport save(const std::string &path, const LineStorage &lines,
+                           std::atomic<size_t> *progress = nullptr) {
+        TRACE_SCOPE("FileWriter::save");
+        SaveReport report;
+        auto begin = std::chrono::steady_clock::now();
+
+        // write next to where a symlink points, not over the link itself
+        char resolved[PATH_MAX];
+        std::string target = realpath(path.c_str(), resolved) ? resolved : path;
+
+        std::string temp = target + ".minima-XXXXXX";
+        int fd = mkstemp(temp.data());
+        if(fd < 0) {
+            report.error = strerror(errno);
+            return report;
+        }
+
+        struct stat info{};
+        if(stat(target.c_str(), &info) == 0) {
+            fchmod(fd, info.st_mode & 07777);
+            (void) !fchown(fd, info.st_uid, info.st_gid); // fine to fail when not root
+        }
+
+        FileWriter writer(fd, progress);
+        lines.forEachSpan([&writer](std::string_view span) {
+            writer.add(span);
+        });
+        writer.flush();
+
+        int error = writer.error;
+        if(!error && fsync(fd) != 0)
+            error = errno;
+        if(close(fd) != 0 && !error)
+            error = errno;
+        if(!error && rename(temp.c_str(), target.c_str()) != 0)
+            error = errno;
+
+        if(error) {
+            unlink(temp.c_str());
+            report.error = strerror(error);
+            return report;
+        }
+
+        // make the rename itself durable
+        std::string dir = target.substr(0, target.find_last_of('/') + 1);
+        int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if(dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+
+        report.ok = true;
+        report.bytes = writer.written;
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return report;
+    }
+};
+
+#endif //MINIMA_FILEWRITER_H
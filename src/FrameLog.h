@@ -0,0 +1,129 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_FRAMELOG_H
+#define MINIMA_FRAMELOG_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+#include "OutputMeter.h"
+
+/**
+ * Times each phase of a frame of the main loop and reports it, one line per
+ * frame, to whoever handed us MINIMA_FRAME_FD. That's minima_replay, which
+ * feeds keys in over a pty and needs to know when they've reached the
+ * screen. The status bar can also show the last frame's timing. Off, and
+ * close to free, when neither wants it.
+ *
+ * A line reads "F keys input tick scroll status view caret refresh bytes",
+ * phase times in nanoseconds, bytes being what went to the terminal.
+ */
+class FrameLog {
+public:
+    enum Phase {INPUT, TICK, SCROLL, STATUS, VIEW, CARET, REFRESH, PHASES};
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr const char *NAMES[PHASES] = {"input", "tick", "scroll", "status", "view", "caret", "refresh"};
+
+    int fd = -1;
+    bool overlay = false;
+    Clock::time_point lapStart{};
+    long long phases[PHASES]{};
+    long long shown[PHASES]{}; // the last frame's, for the status bar
+    long long writtenBefore = 0;
+
+    [[nodiscard]]
+    bool timing() const {
+        return fd >= 0 || overlay;
+    }
+
+public:
+    FrameLog() {
+        const char *env = getenv("MINIMA_FRAME_FD");
+        if(env)
+            fd = atoi(env);
+    }
+
+    /**
+     * A frame starts, once the key that woke the loop is in
+     */
+    void begin() {
+        if(!timing())
+            return;
+        if(fd >= 0)
+            writtenBefore = OutputMeter::written();
+        for(long long &phase : phases)
+            phase = 0;
+        lapStart = Clock::now();
+    }
+
+    /**
+     * Whatever ran since the last lap was `phase`
+     */
+    void lap(Phase phase) {
+        if(!timing())
+            return;
+        auto now = Clock::now();
+        phases[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - lapStart).count();
+        lapStart = now;
+    }
+
+    /**
+     * The frame is on screen, having handled `keys` keys
+     */
+    void end(int keys) {
+        if(!timing())
+            return;
+        std::copy(phases, phases + PHASES, shown);
+        if(fd < 0)
+            return;
+        long long bytes = OutputMeter::written() - writtenBefore;
+        char line[256];
+        int length = snprintf(line, sizeof line, "F %d %lld %lld %lld %lld %lld %lld %lld %lld\n", keys,
+                              phases[INPUT], phases[TICK], phases[SCROLL], phases[STATUS], phases[VIEW],
+                              phases[CARET], phases[REFRESH], bytes);
+        // the driver hanging up just means nobody is listening any more
+        if(write(fd, line, length) != length)
+            fd = -1;
+    }
+
+    /**
+     * Show or hide the timing on the status bar. Called mid frame, so the
+     * frame's laps start over from here.
+     */
+    void toggleOverlay() {
+        overlay = !overlay;
+        std::fill(phases, phases + PHASES, 0);
+        std::fill(shown, shown + PHASES, 0);
+        lapStart = Clock::now();
+    }
+
+    /**
+     * "frame X ms, most in P", or nothing when the overlay is off
+     */
+    [[nodiscard]]
+    std::string describe() const {
+        if(!overlay)
+            return "";
+        long long total = 0;
+        int most = 0;
+        for(int phase = 0; phase < PHASES; phase++) {
+            total += shown[phase];
+            if(shown[phase] > shown[most])
+                most = phase;
+        }
+        char text[64];
+        snprintf(text, sizeof text, "frame %.2f ms, most in %s", (double) total / 1e6, NAMES[most]);
+        return text;
+    }
+};
+
+#endif //MINIMA_FRAMELOG_H
@@ -0,0 +1,245 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_HIGHLIGHTER_H
+#define MINIMA_HIGHLIGHTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "BlockList.h"
+#include "LineStorage.h"
+#include "Lexers.h"
+
+/**
+ * Syntax highlighting for the lines on screen. The state each line ends in
+ * is cached, so drawing a line only lexes that line. After an edit the
+ * changed lines are lexed again, and so are the lines below them only
+ * while their start state differs from before; the first line that ends
+ * the way it used to stops it. Lines nobody has looked at yet are lexed
+ * when they're first drawn.
+ *
+ * Long lines also keep checkpoints of the lexer state every
+ * lex::CHECKPOINT bytes or so. Drawing one lexes from the checkpoint
+ * before the part on screen, and an edit to one lexes from the checkpoint
+ * before the edit until it's back in step with a checkpoint after it.
+ */
+class Highlighter {
+    // lines relexed right after an edit before the rest is left for later
+    static constexpr size_t RELEX_LIMIT = 1000;
+
+    struct LongLine {
+        size_t length;
+        std::vector<lex::Checkpoint> points;
+    };
+
+    const lex::Language *language = nullptr;
+    // end state of lines [0, ends.size()), as far as anything was lexed
+    mutable BlockList<uint8_t> ends{};
+    // checkpoints of the long lines lexed so far; with a multiline language
+    // only of lines in `ends`, since they depend on the state a line starts in
+    mutable std::map<size_t, LongLine> longLines{};
+
+    /**
+     * Lex all of `line`, which starts in `state`. Returns its end state.
+     */
+    uint8_t lexLine(const LineStorage &lines, size_t line, uint8_t state) const {
+        return relex(lines, line, state, nullptr, 0, nullptr, 0, 0);
+    }
+
+    /**
+     * Lex `line`, which starts in `state`, keeping checkpoints if it's long.
+     * After an edit, `head` has the checkpoints it had when its first
+     * `prefix` bytes were the same, and `tail` those of the line its last
+     * `suffix` bytes were at the end of, which ended in `tailEnd`. Returns
+     * the end state.
+     */
+    uint8_t relex(const LineStorage &lines, size_t line, uint8_t state, const LongLine *head, size_t prefix,
+                  const LongLine *tail, size_t suffix, uint8_t tailEnd) const {
+        std::string_view text = lines.at(line).view();
+        lex::Sink sink;
+        if(text.size() < lex::CHECKPOINT) {
+            longLines.erase(line);
+            return language->lex(text, 0, state, sink);
+        }
+
+        // start over from the last checkpoint still good, which gets kept again
+        std::vector<lex::Checkpoint> points;
+        if(head)
+            for(auto point = head->points.begin(); point != head->points.end() && point->at <= prefix; point++)
+                points.push_back(*point);
+        size_t begin = 0;
+        if(!points.empty()) {
+            begin = points.back().at;
+            state = points.back().state;
+            points.pop_back();
+        }
+
+        // and stop at the first of the tail's it gets to in the same state;
+        // a lexer looks back a byte, so not at the first byte of the suffix
+        std::vector<lex::Checkpoint> moved;
+        if(tail)
+            for(const lex::Checkpoint &point : tail->points)
+                if(point.at > tail->length - suffix)
+                    moved.push_back({point.at + text.size() - tail->length, point.state});
+
+        sink.checkpoints = &points;
+        sink.nextCheckpoint = begin;
+        sink.same = moved.data();
+        sink.sameEnd = moved.data() + moved.size();
+        uint8_t end = language->lex(text, begin, state, sink);
+        if(sink.converged) {
+            points.insert(points.end(), sink.same, sink.sameEnd);
+            end = tailEnd;
+        }
+        longLines[line] = {text.size(), std::move(points)};
+        return end;
+    }
+
+    /**
+     * Drop what's known from `line` down
+     */
+    void forget(size_t line) {
+        ends.erase(std::min(line, ends.size()), ends.size());
+        longLines.erase(longLines.lower_bound(line), longLines.end());
+    }
+
+    /**
+     * Lex every line up to and including `line` that hasn't been
+     */
+    void fill(const LineStorage &lines, size_t line) const {
+        if(line < ends.size())
+            return;
+        uint8_t state = ends.size() > 0 ? ends.at(ends.size() - 1) : 0;
+        std::vector<uint8_t> fresh;
+        fresh.reserve(line + 1 - ends.size());
+        for(size_t at = ends.size(); at <= line; at++) {
+            state = lexLine(lines, at, state);
+            fresh.push_back(state);
+        }
+        ends.insert(ends.size(), fresh.begin(), fresh.end());
+    }
+
+public:
+    /**
+     * Highlight as `lang`, or not at all if it's null
+     */
+    void setLanguage(const lex::Language *lang) {
+        language = lang;
+        ends.assign({});
+        longLines.clear();
+    }
+
+    /**
+     * Lines [first, first + removed) were replaced by `added` new ones, the
+     * first `prefix` bytes of the first and last `suffix` bytes of the last
+     * being as they were. Returns the line after the last one that may look
+     * different now, SIZE_MAX if that's everything below.
+     */
+    size_t linesChanged(const LineStorage &lines, int first, int removed, int added,
+                        size_t prefix = 0, size_t suffix = 0) {
+        if(!language)
+            return first + added;
+
+        // the checkpoints of the replaced lines are only any good for the
+        // first and last of them, the ones below move down with their lines
+        std::map<size_t, LongLine> replaced, below;
+        for(auto it = longLines.lower_bound(first); it != longLines.end(); it = longLines.erase(it)) {
+            if(it->first < (size_t) (first + removed))
+                replaced.emplace(it->first, std::move(it->second));
+            else
+                below.emplace(it->first - removed + added, std::move(it->second));
+        }
+        longLines.merge(below);
+        auto known = [&](int line) -> const LongLine * {
+            auto found = replaced.find(line);
+            return found == replaced.end() ? nullptr : &found->second;
+        };
+        const LongLine *head = known(first), *tail = known(first + removed - 1);
+
+        if(!language->multiline) {
+            // the rest get lexed when they're drawn
+            if(head)
+                relex(lines, first, 0, head, prefix, added == 1 ? tail : nullptr, suffix, 0);
+            if(tail && (added > 1 || !head))
+                relex(lines, first + added - 1, 0, nullptr, 0, tail, suffix, 0);
+            return first + added;
+        }
+        if((size_t) first >= ends.size())
+            return first + added;
+        if((size_t) (first + removed) > ends.size()) {
+            forget(first);
+            return SIZE_MAX;
+        }
+
+        // what the line below the change used to start in
+        uint8_t oldEnd = first + removed > 0 ? ends.at(first + removed - 1) : 0;
+        uint8_t state = first > 0 ? ends.at(first - 1) : 0;
+        ends.erase(first, first + removed);
+        std::vector<uint8_t> fresh;
+        fresh.reserve(added);
+        for(int line = first; line < first + added; line++) {
+            state = relex(lines, line, state, line == first ? head : nullptr, prefix,
+                          line == first + added - 1 ? tail : nullptr, suffix, oldEnd);
+            fresh.push_back(state);
+        }
+        ends.insert(first, fresh.begin(), fresh.end());
+
+        size_t line = first + added, limit = line + RELEX_LIMIT;
+        while(state != oldEnd) {
+            if(line >= ends.size())
+                return SIZE_MAX;
+            if(line >= limit) {
+                forget(line); // gets lexed again when shown
+                return SIZE_MAX;
+            }
+            oldEnd = ends.at(line);
+            state = lexLine(lines, line, state);
+            ends.set(line, state);
+            line++;
+        }
+        return line;
+    }
+
+    /**
+     * Tokens on `line` that overlap columns [from, stop)
+     */
+    [[nodiscard]]
+    std::vector<lex::Token> tokens(const LineStorage &lines, size_t line, size_t from, size_t stop) const {
+        std::vector<lex::Token> found;
+        if(!language)
+            return found;
+        std::string_view text = lines.at(line).view();
+        uint8_t state = 0;
+        if(language->multiline) {
+            fill(lines, line);
+            state = line > 0 ? ends.at(line - 1) : 0;
+        }
+
+        // from the last checkpoint at or before `from`
+        size_t begin = 0;
+        if(text.size() >= lex::CHECKPOINT) {
+            if(!longLines.count(line))
+                lexLine(lines, line, state);
+            const std::vector<lex::Checkpoint> &points = longLines.at(line).points;
+            auto after = std::upper_bound(points.begin(), points.end(), from,
+                                          [](size_t at, const lex::Checkpoint &point) { return at < point.at; });
+            if(after != points.begin()) {
+                begin = std::prev(after)->at;
+                state = std::prev(after)->state;
+            }
+        }
+
+        lex::Sink sink;
+        sink.tokens = &found;
+        sink.from = from;
+        sink.stop = stop;
+        language->lex(text, begin, state, sink);
+        return found;
+    }
+};
+
+#endif //MINIMA_HIGHLIGHTER_H
@@ -6,46 +6,292 @@
 #define MINIMA_HISTORY_H
 
 #include <variant>
+#include <chrono>
+#include <optional>
 #include "Structure.h"
 #include "Document.h"
+#include "Compress.h"
+#include "SpillFile.h"
+#include "Trace.h"
+#include "Log.h"
 
 
+/**
+ * Undo and redo. The text of recent actions stays as it is; text over
+ * LARGE_ACTION is compressed straight away, and once history takes more
+ * than its memory budget the oldest text is compressed and then moved out
+ * to a spill file, oldest first.
+ */
 class History {
+    // keystrokes closer together than this fold into one undo step
+    static constexpr std::chrono::milliseconds MERGE_WINDOW{1000};
+    static constexpr size_t LARGE_ACTION = 256 << 10;
+
+    struct Entry {
+        enum Storage {RAW, PACKED, SPILLED};
+        Action action;      // heft only holds the text while RAW
+        Storage storage = RAW;
+        std::string packed; // compressed text while PACKED
+        size_t textSize = 0;
+        off_t offset = 0;   // where the compressed text went once SPILLED
+        size_t packedSize = 0;
+        size_t linesMemory = 0; // what action.lines took when it was recorded
+
+        explicit Entry(Action action) : action(std::move(action)) {}
+
+        [[nodiscard]]
+        size_t memory() const {
+            return sizeof(Entry) + action.heft.size() + packed.size() + linesMemory;
+        }
+    };
+
     Document &document;
-    std::vector<Action> actions{};
+    std::vector<Entry> actions{};
     int currentAction = 0;
     bool freezeHist = false;
+    bool sealed = false; // the last action takes no more merges
+    std::chrono::steady_clock::time_point lastAdded{};
+
+    size_t budget;
+    size_t memory = 0;
+    // every entry before these is at least packed, or spilled, bar runs of
+    // lines that still point into the file
+    size_t packedUpTo = 0, spilledUpTo = 0;
+    SpillFile spill;
+
+    void pack(Entry &entry) {
+        TRACE_SCOPE("History::pack");
+        if(entry.storage != Entry::RAW)
+            return;
+        memory -= entry.memory();
+        if(entry.action.lines) {
+            // lines still pointing into the file cost next to nothing, only
+            // edited text is worth turning back into a string to compress
+            size_t views = entry.action.lines->size() * sizeof(Line);
+            if(entry.linesMemory < 2 * views) {
+                memory += entry.memory();
+                return;
+            }
+            entry.action.heft = Document::joinLines(*entry.action.lines);
+            entry.action.lines.reset();
+            entry.linesMemory = 0;
+        }
+        entry.textSize = entry.action.heft.size();
+        entry.packed = compress::pack(entry.action.heft);
+        entry.packed.shrink_to_fit();
+        std::string().swap(entry.action.heft);
+        entry.storage = Entry::PACKED;
+        memory += entry.memory();
+    }
+
+    bool spillOut(Entry &entry) {
+        TRACE_SCOPE("History::spillOut");
+        pack(entry);
+        if(entry.storage != Entry::PACKED)
+            return true;
+        off_t at = spill.append(entry.packed);
+        if(at < 0)
+            return false; // no room on disk, it stays in memory
+        memory -= entry.memory();
+        entry.offset = at;
+        entry.packedSize = entry.packed.size();
+        std::string().swap(entry.packed);
+        entry.storage = Entry::SPILLED;
+        memory += entry.memory();
+        return true;
+    }
+
+    void enforceBudget() {
+        // the newest entry stays as it is unless it's big, typing may still merge into it
+        Entry &last = actions.back();
+        if(last.action.heft.size() > LARGE_ACTION)
+            pack(last);
+
+        while(memory > budget && packedUpTo + 1 < actions.size())
+            pack(actions[packedUpTo++]);
+        while(memory > budget && spilledUpTo < actions.size()) {
+            if(!spillOut(actions[spilledUpTo]))
+                break;
+            spilledUpTo++;
+        }
+        packedUpTo = std::max(packedUpTo, spilledUpTo);
+    }
+
+    /**
+     * Drop every entry from `first` on
+     */
+    void truncate(size_t first) {
+        if(first >= actions.size())
+            return;
+        for(size_t i = first; i < actions.size(); i++)
+            memory -= actions[i].memory();
+        // runs of lines left in memory can sit among the spilled entries
+        for(size_t i = first; i < spilledUpTo; i++) {
+            if(actions[i].storage == Entry::SPILLED) {
+                spill.truncate(actions[i].offset);
+                break;
+            }
+        }
+        actions.erase(actions.begin() + (long) first, actions.end());
+        packedUpTo = std::min(packedUpTo, first);
+        spilledUpTo = std::min(spilledUpTo, first);
+    }
+
+    /**
+     * The entry's action with its text back in place, or nothing if the
+     * text couldn't be read back
+     */
+    std::optional<Action> restore(const Entry &entry) const {
+        TRACE_SCOPE("History::restore");
+        Action action = entry.action;
+        if(entry.storage == Entry::RAW)
+            return action;
+        try {
+            std::string packed;
+            if(entry.storage == Entry::SPILLED && !spill.read(entry.offset, entry.packedSize, packed))
+                return std::nullopt;
+            action.heft = compress::unpack(entry.storage == Entry::SPILLED ? packed : entry.packed, entry.textSize);
+        } catch(const std::runtime_error &) {
+            return std::nullopt;
+        }
+        if(action.heft.size() != entry.textSize)
+            return std::nullopt;
+        return action;
+    }
+
+    /**
+     * Where text inserted at `start` ends
+     */
+    static Point endOf(Point start, std::string_view text) {
+        size_t lastBreak = text.rfind('\n');
+        if(lastBreak == std::string_view::npos)
+            return {start.line, start.chara + (int) text.size()};
+        int breaks = (int) scan::count(text.data(), text.data() + text.size(), '\n');
+        return {start.line + breaks, (int) (text.size() - lastBreak - 1)};
+    }
+
+    /**
+     * Fold `next` into `last` if it continues it: typing on from where the
+     * insert ended, or deleting on from where the delete happened.
+     */
+    static bool merge(Action &last, const Action &next) {
+        if(last.type != next.type || !last.mergeable || !next.mergeable)
+            return false;
+
+        if(next.type == Action::ADD && next.range.start == last.range.end) {
+            last.heft += next.heft;
+        } else if(next.type == Action::DELETE && next.range.end == last.range.start) {
+            // backspace: the new text sits in front
+            last.heft.insert(0, next.heft);
+            last.range.start = next.range.start;
+        } else if(next.type == Action::DELETE && next.range.start == last.range.start) {
+            // forward delete: the text closes up onto the same point
+            last.heft += next.heft;
+        } else {
+            return false;
+        }
+        last.range.end = endOf(last.range.start, last.heft);
+        return true;
+    }
 
 public:
-    explicit History(Document &doc) : document(doc) {
+    static constexpr size_t DEFAULT_BUDGET = 64 << 20;
+
+    explicit History(Document &doc, size_t budget = DEFAULT_BUDGET) : document(doc), budget(budget) {
     }
 
     void addAction(Action act) {
+        TRACE_SCOPE("History::addAction");
         if(freezeHist)
             return;
 
-        actions.erase(actions.begin() + currentAction, actions.end());
+        truncate(currentAction);
 
-        actions.push_back(act);
+        auto now = std::chrono::steady_clock::now();
+        bool recent = now - lastAdded < MERGE_WINDOW;
+        lastAdded = now;
+        if(!sealed && recent && !actions.empty() && actions.back().storage == Entry::RAW) {
+            Entry &last = actions.back();
+            memory -= last.memory();
+            bool merged = merge(last.action, act);
+            memory += last.memory();
+            if(merged) {
+                enforceBudget();
+                return;
+            }
+        }
+
+        actions.emplace_back(std::move(act));
+        if(actions.back().action.lines) {
+            size_t &linesMemory = actions.back().linesMemory;
+            for(const Line &line : *actions.back().action.lines)
+                linesMemory += sizeof(Line) + line.heapSize();
+        }
+        memory += actions.back().memory();
         currentAction++;
+        sealed = false;
+        enforceBudget();
+    }
+
+    /**
+     * Keep the next action from merging into the last one
+     */
+    void seal() {
+        sealed = true;
     }
 
     void undoLastAction() {
+        TRACE_SCOPE("History::undoLastAction");
         if(currentAction <= 0) {
-            dd("Nothing to undo");
+            notify("Nothing to undo");
             return;
         }
-        Action action = actions.at(--currentAction);
-        undoAction(action);
+        // a chained action goes back together with the one before it
+        bool chained;
+        do {
+            auto action = restore(actions.at(currentAction - 1));
+            if(!action) {
+                notify(logging::ERROR, "Undo history could not be read back");
+                return;
+            }
+            currentAction--;
+            chained = action->chained;
+            undoAction(*action);
+        } while(chained && currentAction > 0);
+        sealed = true;
     }
 
     void redoAction() {
-        if(currentAction >= actions.size()) {
-            dd("At most recent");
+        TRACE_SCOPE("History::redoAction");
+        if(currentAction >= (int) actions.size()) {
+            notify("At most recent");
             return;
         }
-        Action action = actions.at(currentAction++);
-        doAction(action);
+        do {
+            auto action = restore(actions.at(currentAction));
+            if(!action) {
+                notify(logging::ERROR, "Undo history could not be read back");
+                return;
+            }
+            currentAction++;
+            doAction(*action);
+        } while(currentAction < (int) actions.size() && actions.at(currentAction).action.chained);
+        sealed = true;
+    }
+
+    /**
+     * How much the history holds, for the status bar; empty while it's small
+     */
+    [[nodiscard]]
+    std::string describeMemory() const {
+        if(memory + spill.size() < (1 << 20))
+            return "";
+        char buf[64];
+        if(spill.size() > 0)
+            snprintf(buf, sizeof buf, "undo %.1f MB +%.1f MB on disk", (double) memory / 1e6, (double) spill.size() / 1e6);
+        else
+            snprintf(buf, sizeof buf, "undo %.1f MB", (double) memory / 1e6);
+        return buf;
     }
 
 private:
@@ -53,7 +299,10 @@ private:
         freezeHist = true;
         Point origCaret = document.caret();
 
-        if(action.type == Action::DELETE) {
+        if(action.type == Action::DELETE && action.lines) {
+            // the lines go back into the document, redo takes them out again
+            document.putLines(action.range.start, std::move(*action.lines));
+        } else if(action.type == Action::DELETE) {
             document.setCaret(action.range.start);
             document.insertString(action.heft);
         }
@@ -69,7 +318,9 @@ private:
         freezeHist = true;
         Point origCaret = document.caret();
 
-        if(action.type == Action::DELETE) {
+        if(action.type == Action::DELETE && action.lines) {
+            *action.lines = document.takeLines(action.range);
+        } else if(action.type == Action::DELETE) {
             document.deleteRange(action.range);
         }
         if(action.type == Action::ADD) {
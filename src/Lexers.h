@@ -0,0 +1,525 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_LEXERS_H
+#define MINIMA_LEXERS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+/**
+ * Line at a time tokenizers for syntax highlighting. A lexer reads one line
+ * given the state the line above ended in, and returns the state this line
+ * ends in; the state is all a lexer carries between lines, so it covers
+ * exactly the constructs that span them, like block comments.
+ *
+ * A lexer can also start partway into a line from a checkpoint, which is
+ * how long lines get drawn and edited without lexing all of them.
+ */
+namespace lex {
+
+    enum Kind : uint8_t {PLAIN, KEYWORD, TYPE, STRING, NUMBER, COMMENT, PREPROC, HEADING, CODE, EMPHASIS, KEY};
+
+    struct Token {
+        uint32_t start, end;
+        Kind kind;
+    };
+
+    // long lines keep a checkpoint about this often
+    constexpr size_t CHECKPOINT = 64 << 10;
+
+    /**
+     * A position in a line the lexer can pick up from, and the state it's in
+     * there, which may be the middle of a string or comment
+     */
+    struct Checkpoint {
+        size_t at;
+        uint8_t state;
+    };
+
+    /**
+     * Where a lexer puts what it finds, and what says when it's done. Once
+     * it's past `next`, a lexer calls reach() at the next position it could
+     * resume from, or span() over a stretch it skips. Those keep the
+     * checkpoints, stop it at `stop`, and stop it when it catches up with
+     * how the line lexed before an edit.
+     */
+    struct Sink {
+        // tokens overlapping [from, stop), if not null
+        std::vector<Token> *tokens = nullptr;
+        size_t from = 0, stop = SIZE_MAX;
+
+        // a checkpoint at the first resumable position from nextCheckpoint
+        // on, then past each multiple of CHECKPOINT, if not null
+        std::vector<Checkpoint> *checkpoints = nullptr;
+        size_t nextCheckpoint = 0;
+
+        // the line's checkpoints from before an edit, moved to where they
+        // are now. Getting to one in the same state means the rest of the
+        // line lexes as it did, so the lexer stops there with `same` on it.
+        const Checkpoint *same = nullptr, *sameEnd = nullptr;
+        bool converged = false;
+
+        size_t next = 0;
+
+        void emit(size_t start, size_t end, Kind kind) {
+            if(tokens && end > start && end > from && start < stop)
+                tokens->push_back({(uint32_t) start, (uint32_t) end, kind});
+        }
+
+        /**
+         * The lexer could resume anywhere in [begin, end] in `state`. False
+         * when it should stop.
+         */
+        bool span(size_t begin, size_t end, uint8_t state) {
+            if(begin >= stop)
+                return false;
+            for(; same != sameEnd && same->at <= end; same++) {
+                if(same->at >= begin && same->state == state) {
+                    converged = true;
+                    return false;
+                }
+            }
+            if(checkpoints && end >= nextCheckpoint) {
+                size_t at = std::max(begin, nextCheckpoint);
+                checkpoints->push_back({at, state});
+                nextCheckpoint = (at / CHECKPOINT + 1) * CHECKPOINT;
+            }
+            next = stop;
+            if(checkpoints)
+                next = std::min(next, nextCheckpoint);
+            if(same != sameEnd)
+                next = std::min(next, same->at);
+            return true;
+        }
+
+        bool reach(size_t i, uint8_t state) {
+            return span(i, i, state);
+        }
+    };
+
+    /**
+     * Lex `text` from `begin`, where it is in `state`: the state the line
+     * above ended in if `begin` is 0, a checkpoint's otherwise. Returns the
+     * state the line ends in, which only counts if the sink let the lexer
+     * get to the end.
+     */
+    using LexFn = uint8_t (*)(std::string_view text, size_t begin, uint8_t state, Sink &sink);
+
+    struct Language {
+        const char *name;
+        LexFn lex;
+        bool multiline; // whether a line can end in anything but state 0
+    };
+
+    namespace detail {
+        inline bool isDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        inline bool isIdentStart(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        }
+
+        inline bool isIdent(char c) {
+            return isIdentStart(c) || isDigit(c);
+        }
+
+        /**
+         * End of the identifier starting at `i`
+         */
+        inline size_t identEnd(std::string_view text, size_t i) {
+            while(i < text.size() && isIdent(text[i]))
+                i++;
+            return i;
+        }
+
+        /**
+         * End of the number starting at `i`: digits, letters for hex and
+         * suffixes, dots, digit separators and exponent signs
+         */
+        inline size_t numberEnd(std::string_view text, size_t i) {
+            while(i < text.size()) {
+                char c = text[i];
+                bool exponentSign = (c == '+' || c == '-') && i > 0
+                                    && (text[i - 1] == 'e' || text[i - 1] == 'E' || text[i - 1] == 'p' || text[i - 1] == 'P');
+                if(!isIdent(c) && c != '.' && c != '\'' && !exponentSign)
+                    break;
+                i++;
+            }
+            return i;
+        }
+
+        /**
+         * End of the string closed by `quote` that `i` is inside of, in
+         * `state`: past the closing quote, or at the end of the line if
+         * there isn't one or the sink stops the lexer first
+         */
+        inline size_t stringEnd(std::string_view text, size_t i, char quote, uint8_t state, Sink &sink) {
+            while(i < text.size()) {
+                if(i >= sink.next && !sink.reach(i, state))
+                    return text.size();
+                if(text[i] == '\\')
+                    i += 2;
+                else if(text[i++] == quote)
+                    return i;
+            }
+            return text.size();
+        }
+
+        /**
+         * Where `close` next starts from `i`, which is inside what it closes,
+         * in `state`. npos if it isn't on this line or the sink stops the
+         * lexer first.
+         */
+        inline size_t findClose(std::string_view text, size_t i, std::string_view close, uint8_t state, Sink &sink) {
+            while(true) {
+                // a piece at a time, so the sink hears about what's skipped
+                size_t limit = std::max(i, std::min(sink.next, text.size()));
+                size_t found = text.substr(0, std::min(text.size(), limit + close.size() - 1)).find(close, i);
+                if(found != std::string_view::npos || limit == text.size())
+                    return found;
+                if(!sink.span(i, limit, state))
+                    return std::string_view::npos;
+                i = limit;
+            }
+        }
+
+        inline size_t firstNonSpace(std::string_view text) {
+            size_t i = 0;
+            while(i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+                i++;
+            return i;
+        }
+    }
+
+    /* C and C++ */
+
+    // only checkpoints are ever inside a string or char
+    enum CState : uint8_t {C_NORMAL, C_COMMENT, C_STRING, C_CHAR};
+
+    inline uint8_t lexC(std::string_view text, size_t begin, uint8_t state, Sink &sink) {
+        using namespace detail;
+        static const std::unordered_set<std::string_view> keywords = {
+            "alignas", "alignof", "asm", "auto", "break", "case", "catch", "class", "const", "consteval",
+            "constexpr", "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield",
+            "decltype", "default", "delete", "do", "dynamic_cast", "else", "enum", "explicit", "export",
+            "extern", "false", "final", "for", "friend", "goto", "if", "inline", "mutable", "namespace",
+            "new", "noexcept", "nullptr", "operator", "override", "private", "protected", "public",
+            "register", "reinterpret_cast", "requires", "return", "sizeof", "static", "static_assert",
+            "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true", "try",
+            "typedef", "typeid", "typename", "union", "using", "virtual", "volatile", "while", "NULL"};
+        static const std::unordered_set<std::string_view> types = {
+            "bool", "char", "char8_t", "char16_t", "char32_t", "double", "float", "int", "long", "short",
+            "signed", "unsigned", "void", "wchar_t", "size_t", "ssize_t", "ptrdiff_t", "int8_t", "int16_t",
+            "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t", "uintptr_t", "off_t"};
+
+        size_t i = begin;
+        if(state == C_COMMENT) {
+            size_t close = findClose(text, i, "*/", C_COMMENT, sink);
+            if(close == std::string_view::npos) {
+                sink.emit(i, text.size(), COMMENT);
+                return C_COMMENT;
+            }
+            sink.emit(i, close + 2, COMMENT);
+            i = close + 2;
+        } else if(state == C_STRING || state == C_CHAR) {
+            size_t end = stringEnd(text, i, state == C_STRING ? '"' : '\'', state, sink);
+            sink.emit(i, end, STRING);
+            i = end;
+        } else if(begin == 0) {
+            size_t hash = firstNonSpace(text);
+            if(hash < text.size() && text[hash] == '#') {
+                size_t end = identEnd(text, firstNonSpace(text.substr(hash + 1)) + hash + 1);
+                sink.emit(hash, end, PREPROC);
+                i = end;
+            }
+        }
+
+        while(i < text.size()) {
+            if(i >= sink.next && !sink.reach(i, C_NORMAL))
+                return C_NORMAL;
+            char c = text[i];
+            if(c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+                sink.emit(i, text.size(), COMMENT);
+                return C_NORMAL;
+            }
+            if(c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+                size_t close = findClose(text, i + 2, "*/", C_COMMENT, sink);
+                if(close == std::string_view::npos) {
+                    sink.emit(i, text.size(), COMMENT);
+                    return C_COMMENT;
+                }
+                sink.emit(i, close + 2, COMMENT);
+                i = close + 2;
+            } else if(c == '"' || c == '\'') {
+                size_t end = stringEnd(text, i + 1, c, c == '"' ? C_STRING : C_CHAR, sink);
+                sink.emit(i, end, STRING);
+                i = end;
+            } else if(isDigit(c) || (c == '.' && i + 1 < text.size() && isDigit(text[i + 1]))) {
+                size_t end = numberEnd(text, i);
+                sink.emit(i, end, NUMBER);
+                i = end;
+            } else if(isIdentStart(c)) {
+                size_t end = identEnd(text, i);
+                std::string_view word = text.substr(i, end - i);
+                if(sink.tokens && keywords.count(word))
+                    sink.emit(i, end, KEYWORD);
+                else if(sink.tokens && types.count(word))
+                    sink.emit(i, end, TYPE);
+                i = end;
+            } else {
+                i++;
+            }
+        }
+        return C_NORMAL;
+    }
+
+    /* Python */
+
+    // only checkpoints are ever inside a one line string
+    enum PyState : uint8_t {PY_NORMAL, PY_SINGLE_TRIPLE, PY_DOUBLE_TRIPLE, PY_SINGLE, PY_DOUBLE};
+
+    inline uint8_t lexPython(std::string_view text, size_t begin, uint8_t state, Sink &sink) {
+        using namespace detail;
+        static const std::unordered_set<std::string_view> keywords = {
+            "and", "as", "assert", "async", "await", "break", "case", "class", "continue", "def", "del",
+            "elif", "else", "except", "False", "finally", "for", "from", "global", "if", "import", "in",
+            "is", "lambda", "match", "None", "nonlocal", "not", "or", "pass", "raise", "return", "True",
+            "try", "while", "with", "yield", "self"};
+
+        size_t i = begin;
+        if(state == PY_SINGLE_TRIPLE || state == PY_DOUBLE_TRIPLE) {
+            size_t close = findClose(text, i, state == PY_SINGLE_TRIPLE ? "'''" : "\"\"\"", state, sink);
+            if(close == std::string_view::npos) {
+                sink.emit(i, text.size(), STRING);
+                return state;
+            }
+            sink.emit(i, close + 3, STRING);
+            i = close + 3;
+        } else if(state == PY_SINGLE || state == PY_DOUBLE) {
+            size_t end = stringEnd(text, i, state == PY_DOUBLE ? '"' : '\'', state, sink);
+            sink.emit(i, end, STRING);
+            i = end;
+        }
+
+        while(i < text.size()) {
+            if(i >= sink.next && !sink.reach(i, PY_NORMAL))
+                return PY_NORMAL;
+            char c = text[i];
+            if(c == '#') {
+                sink.emit(i, text.size(), COMMENT);
+                return PY_NORMAL;
+            }
+            if(c == '"' || c == '\'') {
+                std::string_view triple = c == '"' ? "\"\"\"" : "'''";
+                if(text.substr(i, 3) == triple) {
+                    uint8_t inside = c == '"' ? PY_DOUBLE_TRIPLE : PY_SINGLE_TRIPLE;
+                    size_t close = findClose(text, i + 3, triple, inside, sink);
+                    if(close == std::string_view::npos) {
+                        sink.emit(i, text.size(), STRING);
+                        return inside;
+                    }
+                    sink.emit(i, close + 3, STRING);
+                    i = close + 3;
+                } else {
+                    size_t end = stringEnd(text, i + 1, c, c == '"' ? PY_DOUBLE : PY_SINGLE, sink);
+                    sink.emit(i, end, STRING);
+                    i = end;
+                }
+            } else if(c == '@' && firstNonSpace(text) == i) {
+                size_t end = identEnd(text, i + 1);
+                sink.emit(i, end, PREPROC);
+                i = end;
+            } else if(isDigit(c) || (c == '.' && i + 1 < text.size() && isDigit(text[i + 1]))) {
+                size_t end = numberEnd(text, i);
+                sink.emit(i, end, NUMBER);
+                i = end;
+            } else if(isIdentStart(c)) {
+                size_t end = identEnd(text, i);
+                if(sink.tokens && keywords.count(text.substr(i, end - i)))
+                    sink.emit(i, end, KEYWORD);
+                i = end;
+            } else {
+                i++;
+            }
+        }
+        return PY_NORMAL;
+    }
+
+    /* JSON, where nothing spans lines */
+
+    // only checkpoints are ever inside a string
+    enum JsonState : uint8_t {JSON_NORMAL, JSON_STRING};
+
+    inline uint8_t lexJson(std::string_view text, size_t begin, uint8_t state, Sink &sink) {
+        using namespace detail;
+        if(!sink.tokens && !sink.checkpoints)
+            return JSON_NORMAL;
+        // the string opened at `start`, read on from `i`; followed by a colon it's a key
+        auto string = [&](size_t start, size_t i) {
+            size_t end = stringEnd(text, i, '"', JSON_STRING, sink);
+            std::string_view seen = text;
+            if(end == text.size() && end > sink.stop) {
+                // cut short where tokens stop being wanted, so look a bit
+                // further for its end
+                seen = text.substr(0, sink.stop + CHECKPOINT);
+                Sink plain;
+                end = stringEnd(seen, i, '"', JSON_STRING, plain);
+            }
+            size_t after = end + firstNonSpace(seen.substr(end));
+            sink.emit(start, end, after < seen.size() && seen[after] == ':' ? KEY : STRING);
+            return end;
+        };
+
+        size_t i = begin;
+        if(state == JSON_STRING)
+            i = string(i, i);
+
+        while(i < text.size()) {
+            if(i >= sink.next && !sink.reach(i, JSON_NORMAL))
+                return JSON_NORMAL;
+            char c = text[i];
+            if(c == '"') {
+                i = string(i, i + 1);
+            } else if(isDigit(c) || c == '-') {
+                size_t end = numberEnd(text, i + 1);
+                sink.emit(i, end, NUMBER);
+                i = end;
+            } else if(isIdentStart(c)) {
+                size_t end = identEnd(text, i);
+                std::string_view word = text.substr(i, end - i);
+                if(word == "true" || word == "false" || word == "null")
+                    sink.emit(i, end, KEYWORD);
+                i = end;
+            } else {
+                i++;
+            }
+        }
+        return JSON_NORMAL;
+    }
+
+    /* Markdown */
+
+    enum MdState : uint8_t {MD_NORMAL, MD_FENCE};
+
+    // how far along a line code spans, emphasis and links get closed
+    constexpr size_t MD_INLINE_REACH = 4096;
+
+    inline uint8_t lexMarkdown(std::string_view text, size_t begin, uint8_t state, Sink &sink) {
+        using namespace detail;
+        size_t i = begin;
+        if(begin == 0) {
+            size_t indent = firstNonSpace(text);
+            std::string_view rest = text.substr(indent);
+            bool fence = rest.substr(0, 3) == "```" || rest.substr(0, 3) == "~~~";
+
+            if(state == MD_FENCE || fence) {
+                sink.emit(0, text.size(), CODE);
+                return (state == MD_FENCE) != fence ? MD_FENCE : MD_NORMAL;
+            }
+            if(!sink.tokens && !sink.checkpoints)
+                return MD_NORMAL;
+
+            if(!rest.empty() && rest[0] == '#') {
+                sink.emit(indent, text.size(), HEADING);
+                return MD_NORMAL;
+            }
+            if(!rest.empty() && rest[0] == '>') {
+                sink.emit(indent, text.size(), COMMENT);
+                return MD_NORMAL;
+            }
+
+            i = indent;
+            // list markers
+            if(rest.size() >= 2 && (rest[0] == '-' || rest[0] == '*' || rest[0] == '+') && rest[1] == ' ') {
+                sink.emit(i, i + 1, KEYWORD);
+                i += 2;
+            } else {
+                size_t digits = i;
+                while(digits < text.size() && isDigit(text[digits]))
+                    digits++;
+                if(digits > i && digits + 1 < text.size() && text[digits] == '.' && text[digits + 1] == ' ') {
+                    sink.emit(i, digits + 1, KEYWORD);
+                    i = digits + 2;
+                }
+            }
+        }
+
+        while(i < text.size()) {
+            if(i >= sink.next && !sink.reach(i, MD_NORMAL))
+                return MD_NORMAL;
+            char c = text[i];
+            std::string_view near = text.substr(0, i + MD_INLINE_REACH);
+            if(c == '`') {
+                size_t close = near.find('`', i + 1);
+                size_t end = close == std::string_view::npos ? text.size() : close + 1;
+                sink.emit(i, end, CODE);
+                i = end;
+            } else if(c == '_' && i > 0 && isIdent(text[i - 1])) {
+                i++; // inside a snake_case word
+            } else if(c == '*' || c == '_') {
+                // **bold** or *emphasis*, only if it closes on this line
+                std::string_view mark = text.substr(i, i + 1 < text.size() && text[i + 1] == c ? 2 : 1);
+                size_t close = near.find(mark, i + mark.size());
+                if(close == std::string_view::npos || close == i + mark.size()) {
+                    i += mark.size();
+                    continue;
+                }
+                sink.emit(i, close + mark.size(), EMPHASIS);
+                i = close + mark.size();
+            } else if(c == '[') {
+                // [text](target), the target shown as a string
+                size_t close = near.find("](", i + 1);
+                size_t end = close == std::string_view::npos ? close : near.find(')', close + 2);
+                if(end == std::string_view::npos) {
+                    i++;
+                    continue;
+                }
+                sink.emit(close + 1, end + 1, STRING);
+                i = end + 1;
+            } else {
+                i++;
+            }
+        }
+        return MD_NORMAL;
+    }
+
+    /**
+     * The language a file is in going by its extension, or null for plain
+     * text
+     */
+    inline const Language *forFile(const std::string &path) {
+        static const Language c{"C/C++", lexC, true};
+        static const Language python{"Python", lexPython, true};
+        static const Language json{"JSON", lexJson, false};
+        static const Language markdown{"Markdown", lexMarkdown, true};
+
+        size_t dot = path.rfind('.');
+        if(dot == std::string::npos || path.find('/', dot) != std::string::npos)
+            return nullptr;
+        std::string extension = path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char ch) { return (char) std::tolower(ch); });
+
+        static const std::unordered_set<std::string_view> cExtensions = {
+            "c", "h", "cc", "cpp", "cxx", "hh", "hpp", "hxx", "inl", "ipp"};
+        if(cExtensions.count(extension))
+            return &c;
+        if(extension == "py" || extension == "pyw")
+            return &python;
+        if(extension == "json")
+            return &json;
+        if(extension == "md" || extension == "markdown")
+            return &markdown;
+        return nullptr;
+    }
+}
+
+#endif //MINIMA_LEXERS_H
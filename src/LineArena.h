@@ -0,0 +1,110 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_LINEARENA_H
+#define MINIMA_LINEARENA_H
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+/**
+ * Big chunks that the text of many lines is packed into, so a line that
+ * didn't come from the file costs its bytes rather than a heap block and
+ * string header of its own. Each chunk counts the lines pointing into it
+ * and is freed with the last one.
+ *
+ * Chunks are allocated aligned to CHUNK, so the header of the chunk a piece
+ * of text lives in is found by rounding its address down; lines carry no
+ * pointer to their chunk.
+ */
+class LineArena {
+    static constexpr size_t CHUNK = 1 << 20;
+    // pieces bigger than this get a chunk to themselves instead of
+    // abandoning the rest of the current one
+    static constexpr size_t LARGE = CHUNK / 8;
+
+    struct Header {
+        std::atomic<size_t> refs;
+    };
+
+    // chunk being filled; the arena holds one reference on it
+    Header *current = nullptr;
+    size_t used = 0;
+
+    static Header *headerOf(const char *text) {
+        return reinterpret_cast<Header *>(reinterpret_cast<uintptr_t>(text) & ~(uintptr_t) (CHUNK - 1));
+    }
+
+    static Header *allocate(size_t bytes) {
+        size_t rounded = (bytes + CHUNK - 1) / CHUNK * CHUNK;
+        void *memory = std::aligned_alloc(CHUNK, rounded);
+        if(!memory)
+            throw std::bad_alloc();
+        return new(memory) Header{{1}};
+    }
+
+    static void release(Header *header) {
+        if(header->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            header->~Header();
+            std::free(header);
+        }
+    }
+
+public:
+    LineArena() = default;
+    LineArena(const LineArena &) = delete;
+    LineArena &operator=(const LineArena &) = delete;
+
+    ~LineArena() {
+        if(current)
+            release(current);
+    }
+
+    /**
+     * Copy `piece`, which must not be empty, into a chunk and return where
+     * it went. The caller owns one reference on that chunk.
+     */
+    const char *add(std::string_view piece) {
+        Header *into;
+        size_t at;
+        if(piece.size() > LARGE) {
+            into = allocate(sizeof(Header) + piece.size());
+            at = sizeof(Header);
+        } else {
+            if(!current || used + piece.size() > CHUNK) {
+                if(current)
+                    release(current);
+                current = allocate(CHUNK);
+                used = sizeof(Header);
+            }
+            into = current;
+            at = used;
+            used += piece.size();
+            into->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        char *text = reinterpret_cast<char *>(into) + at;
+        std::memcpy(text, piece.data(), piece.size());
+        return text;
+    }
+
+    /**
+     * Another reference on the chunk `text` is in
+     */
+    static void retain(const char *text) {
+        headerOf(text)->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Drop a reference on the chunk `text` is in
+     */
+    static void release(const char *text) {
+        release(headerOf(text));
+    }
+};
+
+#endif //MINIMA_LINEARENA_H
@@ -0,0 +1,165 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_LINECOUNTS_H
+#define MINIMA_LINECOUNTS_H
+
+#include <cstdint>
+#include <vector>
+#include <optional>
+
+#include "BlockList.h"
+#include "LineStorage.h"
+
+/**
+ * How many of something each line holds, cached in a weighted BlockList so
+ * finding the k-th one after or before a line is a Fenwick lookup instead
+ * of a walk over the lines in between. Counts are worked out a chunk at a
+ * time as lookups reach lines that don't have one yet, and dropped when a
+ * line changes.
+ *
+ * `Measure` is called as measure(lines, line) and may look at the line
+ * above, so an edit also drops the count of the line after it.
+ */
+template <typename Measure>
+class LineCounts {
+    // lines counted at once when a lookup runs into uncounted ones
+    static constexpr size_t CHUNK = 1024;
+
+    struct Same {
+        size_t operator()(uint32_t n) const {
+            return n;
+        }
+    };
+
+    // per line count, 0 while unknown; lines past the end are unknown too
+    mutable BlockList<uint32_t, Same> counts{};
+    // 1 for every line whose count is unknown, so known stretches can be
+    // found and skipped in one lookup
+    mutable BlockList<uint32_t, Same> unknown{};
+
+    /**
+     * First uncounted line at or after `line`
+     */
+    [[nodiscard]]
+    size_t nextUnknown(size_t line) const {
+        if(line >= unknown.size())
+            return line;
+        return unknown.findWeight(unknown.weightBefore(line)).first;
+    }
+
+    /**
+     * One past the last uncounted line before `line`, 0 if there is none
+     */
+    [[nodiscard]]
+    size_t knownFrom(size_t line) const {
+        if(line > unknown.size())
+            return line;
+        size_t before = unknown.weightBefore(line);
+        return before == 0 ? 0 : unknown.findWeight(before - 1).first + 1;
+    }
+
+    /**
+     * Count the lines in [first, last) that aren't yet
+     */
+    void fill(const LineStorage &lines, size_t first, size_t last) const {
+        // lines whose count an edit dropped
+        size_t end = std::min(last, counts.size());
+        for(size_t line = nextUnknown(first); line < end; line = nextUnknown(line + 1)) {
+            counts.set(line, Measure{}(lines, line));
+            unknown.set(line, 0);
+        }
+
+        // lines never counted go on the end in one insert
+        if(counts.size() < last) {
+            std::vector<uint32_t> fresh, known(last - counts.size(), 0);
+            fresh.reserve(known.size());
+            for(size_t line = counts.size(); line < last; line++)
+                fresh.push_back(Measure{}(lines, line));
+            counts.insert(counts.size(), fresh.begin(), fresh.end());
+            unknown.insert(unknown.size(), known.begin(), known.end());
+        }
+    }
+
+public:
+    /**
+     * Forget every count, for when the whole text is replaced
+     */
+    void reset() {
+        counts.assign({});
+        unknown.assign({});
+    }
+
+    /**
+     * Lines [first, first + removed) were replaced by `added` new ones
+     */
+    void linesChanged(int first, int removed, int added) {
+        if((size_t) first > counts.size())
+            return;
+        size_t last = std::min(counts.size(), (size_t) first + removed);
+        counts.erase(first, last);
+        unknown.erase(first, last);
+        std::vector<uint32_t> zeros(added, 0), ones(added, 1);
+        counts.insert(first, zeros.begin(), zeros.end());
+        unknown.insert(first, ones.begin(), ones.end());
+
+        size_t below = first + added;
+        if(below < counts.size()) {
+            counts.set(below, 0);
+            unknown.set(below, 1);
+        }
+    }
+
+    /**
+     * The k-th (from 0) thing counted on the lines after `line`, as the
+     * line it's on and its rank within that line, or nothing if the
+     * document runs out first
+     */
+    [[nodiscard]]
+    std::optional<std::pair<size_t, size_t>> after(const LineStorage &lines, size_t line, size_t k) const {
+        size_t next = line + 1;
+        while(true) {
+            // jump over the counted stretch in one go
+            size_t stop = nextUnknown(next);
+            size_t skipped = counts.weightBefore(next);
+            size_t here = counts.weightBefore(stop) - skipped;
+            if(k < here) {
+                auto [found, weightBefore] = counts.findWeight(skipped + k);
+                return std::make_pair(found, skipped + k - weightBefore);
+            }
+            k -= here;
+            next = stop;
+
+            if(!lines.hasLine(next))
+                return std::nullopt;
+            fill(lines, next, (size_t) lines.clampLine((long) (next + CHUNK - 1)) + 1);
+        }
+    }
+
+    /**
+     * The k-th (from 0) thing counted on the lines before `line`, going
+     * backwards, as the line it's on and its rank within that line counted
+     * from the start of the line
+     */
+    [[nodiscard]]
+    std::optional<std::pair<size_t, size_t>> before(const LineStorage &lines, size_t line, size_t k) const {
+        while(true) {
+            size_t first = knownFrom(line);
+            size_t upTo = counts.weightBefore(line);
+            size_t here = upTo - counts.weightBefore(first);
+            if(k < here) {
+                auto [found, weightBefore] = counts.findWeight(upTo - k - 1);
+                return std::make_pair(found, upTo - k - 1 - weightBefore);
+            }
+            k -= here;
+            line = first;
+
+            if(line == 0)
+                return std::nullopt;
+            fill(lines, line > CHUNK ? line - CHUNK : 0, line);
+        }
+    }
+};
+
+#endif //MINIMA_LINECOUNTS_H
@@ -0,0 +1,397 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_LINESTORAGE_H
+#define MINIMA_LINESTORAGE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+#include "BlockList.h"
+#include "FileMap.h"
+#include "LineArena.h"
+#include "Scan.h"
+
+/**
+ * One line of text, without its newline. Lines straight from the file are
+ * views into the mapping, and text from elsewhere is packed into a
+ * LineArena; the first edit copies the line into its own buffer. Sixteen
+ * bytes however the text is held.
+ */
+class Line {
+    enum Kind {VIEW, PACKED, OWNED};
+
+    union {
+        const char *text;   // VIEW and PACKED
+        std::string *owned; // OWNED
+    };
+    uint64_t length : 62;   // of text, unused while OWNED
+    uint64_t kind : 2;
+
+    void drop() {
+        if(kind == PACKED)
+            LineArena::release(text);
+        else if(kind == OWNED)
+            delete owned;
+    }
+
+    void steal(Line &other) {
+        text = other.text;
+        length = other.length;
+        kind = other.kind;
+        other.text = "";
+        other.length = 0;
+        other.kind = VIEW;
+    }
+
+public:
+    Line() : text(""), length(0), kind(VIEW) {}
+    explicit Line(std::string_view mapped) : text(mapped.data()), length(mapped.size()), kind(VIEW) {}
+    explicit Line(std::string text) : owned(new std::string(std::move(text))), length(0), kind(OWNED) {}
+
+    /**
+     * A line holding `text` packed into `arena`
+     */
+    Line(LineArena &arena, std::string_view text) : Line() {
+        if(text.empty())
+            return;
+        this->text = arena.add(text);
+        length = text.size();
+        kind = PACKED;
+    }
+
+    // copies happen when a snapshot's block is cloned, edited text is duplicated
+    Line(const Line &other) : text(other.text), length(other.length), kind(other.kind) {
+        if(kind == PACKED)
+            LineArena::retain(text);
+        else if(kind == OWNED)
+            owned = new std::string(*other.owned);
+    }
+    Line &operator=(const Line &other) {
+        if(this != &other)
+            *this = Line(other);
+        return *this;
+    }
+    Line(Line &&other) noexcept : Line() {
+        steal(other);
+    }
+    Line &operator=(Line &&other) noexcept {
+        if(this != &other) {
+            drop();
+            steal(other);
+        }
+        return *this;
+    }
+    ~Line() {
+        drop();
+    }
+
+    [[nodiscard]]
+    std::string_view view() const {
+        if(kind == OWNED)
+            return *owned;
+        return {text, (size_t) length};
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return view().size();
+    }
+
+    [[nodiscard]]
+    char at(size_t i) const {
+        return view().at(i);
+    }
+
+    /**
+     * Bytes the line keeps alive on the heap, 0 while it points into the
+     * mapping
+     */
+    [[nodiscard]]
+    size_t heapSize() const {
+        if(kind == OWNED)
+            return owned->capacity();
+        return kind == PACKED ? (size_t) length : 0;
+    }
+
+    /**
+     * Writable text of the line, copied out of the mapping or arena if needed
+     */
+    std::string &edit() {
+        if(kind != OWNED) {
+            auto *copy = new std::string(view());
+            drop();
+            owned = copy;
+            length = 0;
+            kind = OWNED;
+        }
+        return *owned;
+    }
+};
+
+static_assert(sizeof(Line) == 16, "lines are kept by the million, keep them small");
+
+/**
+ * Backing store for the document's lines: a BlockList of Lines, filled
+ * lazily from a FileMap. Only the part of the file that has been asked for
+ * is split into lines, so opening a big file costs about as much as reading
+ * its first screen. Swap this class out to change how text is stored; the
+ * Document only relies on the interface below.
+ *
+ * Each line weighs its length plus its newline, so the byte offset of a line
+ * and the line holding a byte offset are both O(log lines).
+ */
+class LineStorage {
+    // how many lines past the requested one to index, so scrolling down
+    // doesn't rescan one line at a time
+    static constexpr size_t INDEX_AHEAD = 4096;
+
+    struct Bytes {
+        size_t operator()(const Line &line) const {
+            return line.size() + 1;
+        }
+    };
+
+    mutable BlockList<Line, Bytes> lines{};
+    std::shared_ptr<FileMap> file{};
+    // text that isn't in the file, shared with snapshots, which never add to it
+    std::shared_ptr<LineArena> arena = std::make_shared<LineArena>();
+    mutable size_t indexedBytes = 0;
+    mutable bool complete = true;
+
+    /**
+     * Split the mapping into lines until `line` exists or the file runs out
+     */
+    void indexUntil(size_t line) const {
+        if(complete || line < lines.size())
+            return;
+
+        std::string_view text = file->view();
+        size_t target = line + INDEX_AHEAD;
+        std::vector<Line> found;
+        scan::forEachLine(text.substr(indexedBytes), [&](std::string_view piece) {
+            found.emplace_back(piece);
+            size_t pieceEnd = piece.data() + piece.size() - text.data();
+            if(pieceEnd == text.size()) {
+                // whatever follows the last newline is the last line, even if empty
+                indexedBytes = text.size();
+                complete = true;
+            } else {
+                indexedBytes = pieceEnd + 1;
+            }
+            return lines.size() + found.size() <= target;
+        });
+        lines.insert(lines.size(),
+                     std::make_move_iterator(found.begin()),
+                     std::make_move_iterator(found.end()));
+    }
+
+public:
+    LineStorage() {
+        lines.insert(0, Line());
+    }
+
+    void load(std::shared_ptr<FileMap> source) {
+        lines.assign({});
+        file = std::move(source);
+        indexedBytes = 0;
+        complete = false;
+        indexUntil(0);
+    }
+
+    /**
+     * A line holding a copy of `text`, packed in with the other text that
+     * didn't come from the file
+     */
+    Line pack(std::string_view text) {
+        return {*arena, text};
+    }
+
+    /**
+     * Total line count. Indexes the rest of the file if it hasn't been yet,
+     * so prefer hasLine/clampLine where an exact count isn't needed.
+     */
+    [[nodiscard]]
+    size_t size() const {
+        indexUntil(SIZE_MAX - INDEX_AHEAD);
+        return lines.size();
+    }
+
+    /**
+     * Number of lines indexed so far; a lower bound on size()
+     */
+    [[nodiscard]]
+    size_t knownSize() const {
+        return lines.size();
+    }
+
+    [[nodiscard]]
+    bool hasLine(long line) const {
+        if(line < 0)
+            return false;
+        indexUntil(line);
+        return (size_t) line < lines.size();
+    }
+
+    /**
+     * Clamp to a valid line number, only indexing as far as `line`
+     */
+    [[nodiscard]]
+    int clampLine(long line) const {
+        if(line <= 0)
+            return 0;
+        indexUntil(line);
+        return (int) std::min((size_t) line, lines.size() - 1);
+    }
+
+    [[nodiscard]]
+    const Line &at(size_t line) const {
+        indexUntil(line);
+        return lines.at(line);
+    }
+
+    /**
+     * Change the text of a line with f(std::string &)
+     */
+    template <typename F>
+    void edit(size_t line, F f) {
+        indexUntil(line);
+        lines.modify(line, [&f](Line &text) { f(text.edit()); });
+    }
+
+    /**
+     * Bytes before the start of `line`, newlines included
+     */
+    [[nodiscard]]
+    size_t offsetOf(size_t line) const {
+        indexUntil(line);
+        return lines.weightBefore(line);
+    }
+
+    /**
+     * Line holding byte `offset` and the column it's at, clamped to the end
+     * of the document. Only indexes as far as the offset.
+     */
+    [[nodiscard]]
+    std::pair<size_t, size_t> lineAtOffset(size_t offset) const {
+        while(!complete && lines.totalWeight() <= offset)
+            indexUntil(lines.size());
+        if(offset >= lines.totalWeight()) {
+            size_t last = lines.size() - 1;
+            return {last, lines.at(last).size()};
+        }
+        auto [line, before] = lines.findWeight(offset);
+        return {line, offset - before};
+    }
+
+    template <typename F>
+    void forEach(size_t first, size_t last, F f) const {
+        indexUntil(last == 0 ? 0 : last - 1);
+        lines.forEach(first, last, f);
+    }
+
+    /**
+     * Calls f with the text of the whole document in order, as line spans and
+     * "\n" separators. The part of the file not indexed yet is passed as one
+     * raw span rather than being split into lines first.
+     */
+    template <typename F>
+    void forEachSpan(F f) const {
+        bool first = true;
+        lines.forEach(0, lines.size(), [&](const Line &line) {
+            if(!first)
+                f(std::string_view("\n"));
+            first = false;
+            f(line.view());
+        });
+        if(!complete) {
+            f(std::string_view("\n"));
+            f(file->view().substr(indexedBytes));
+        }
+    }
+
+    /**
+     * Calls f with the text of every line in order until it returns false.
+     * Lines past the indexed part are split off the mapping as it goes
+     * without being indexed, so a snapshot can be walked from another thread
+     * without growing.
+     */
+    template <typename F>
+    void forEachView(F f) const {
+        bool going = true;
+        lines.forEachWhile(0, lines.size(), [&](const Line &line) {
+            return going = f(line.view());
+        });
+        if(going && !complete)
+            scan::forEachLine(file->view().substr(indexedBytes), f);
+    }
+
+    /**
+     * Calls f(lineNumber, line) from `first` to the end of the file, indexing
+     * only as far as the walk gets, until f returns false. f may look at up
+     * to `ahead` lines past the one it's given; those are indexed before it's
+     * called, since indexing while the walk holds a block would free it.
+     */
+    template <typename F>
+    void scanForward(size_t first, F f, size_t ahead = 0) const {
+        while(true) {
+            indexUntil(first + ahead);
+            size_t known = lines.size();
+            size_t end = complete ? known : known - std::min(known, ahead);
+            size_t number = first;
+            size_t stop = lines.forEachWhile(first, end, [&](const Line &line) {
+                return f(number++, line);
+            });
+            if(stop < end || complete)
+                return;
+            first = end;
+        }
+    }
+
+    /**
+     * Calls f(lineNumber, line) from `first` back to line 0, until f returns
+     * false. f may look at up to `ahead` lines past the one it's given.
+     */
+    template <typename F>
+    void scanBackward(size_t first, F f, size_t ahead = 0) const {
+        indexUntil(first + ahead);
+        first = std::min(first, lines.size() - 1);
+        long number = (long) first;
+        lines.forEachReverseWhile(0, first + 1, [&](const Line &line) {
+            return f((size_t) number--, line);
+        });
+    }
+
+    void insert(size_t line, Line text) {
+        indexUntil(line);
+        lines.insert(line, std::move(text));
+    }
+
+    template <typename It>
+    void insert(size_t line, It first, It last) {
+        indexUntil(line);
+        lines.insert(line, first, last);
+    }
+
+    /**
+     * Erase lines in [first, last)
+     */
+    void erase(size_t first, size_t last) {
+        indexUntil(last);
+        lines.erase(first, last);
+    }
+
+    /**
+     * Erase lines in [first, last) and hand them back as they are, so
+     * their text is moved rather than copied
+     */
+    std::vector<Line> extract(size_t first, size_t last) {
+        indexUntil(last);
+        return lines.extract(first, last);
+    }
+};
+
+#endif //MINIMA_LINESTORAGE_H
@@ -0,0 +1,160 @@
+#include "Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+namespace logging {
+    namespace {
+        constexpr size_t RECORDS = 1024;
+        constexpr std::chrono::milliseconds FLUSH_INTERVAL{200};
+
+        struct Record {
+            // 1 + the record's number once it's written, 0 while it's being written
+            std::atomic<uint64_t> seq{0};
+            timespec time;
+            Level level;
+            char text[TEXT];
+        };
+
+        Record ring[RECORDS];
+        std::atomic<uint64_t> next{0};
+
+        // the writer thread, and what it has written up to
+        FILE *file = nullptr;
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        uint64_t written = 0;
+
+        const char *NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+        /**
+         * Write out the records that came in since last time
+         */
+        void flush() {
+            uint64_t last = next.load(std::memory_order_acquire);
+            if(last - written > RECORDS) {
+                fprintf(file, "... %llu records dropped\n", (unsigned long long) (last - RECORDS - written));
+                written = last - RECORDS;
+            }
+            for(; written < last; written++) {
+                Record &record = ring[written % RECORDS];
+                if(record.seq.load(std::memory_order_acquire) != written + 1)
+                    break; // still being written, pick it up next time
+                Record copy;
+                copy.time = record.time;
+                copy.level = record.level;
+                memcpy(copy.text, record.text, TEXT);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(record.seq.load(std::memory_order_relaxed) != written + 1)
+                    continue; // lapped while copying
+
+                tm local{};
+                localtime_r(&copy.time.tv_sec, &local);
+                char stamp[32];
+                strftime(stamp, sizeof stamp, "%F %T", &local);
+                fprintf(file, "%s.%03ld %-5s %s\n", stamp, copy.time.tv_nsec / 1000000, NAMES[copy.level], copy.text);
+            }
+            fflush(file);
+        }
+    }
+
+    void write(Level level, const char *format, ...) {
+        uint64_t number = next.fetch_add(1, std::memory_order_relaxed);
+        Record &record = ring[number % RECORDS];
+        record.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        clock_gettime(CLOCK_REALTIME, &record.time);
+        record.level = level;
+        va_list args;
+        va_start(args, format);
+        vsnprintf(record.text, TEXT, format, args);
+        va_end(args);
+        record.seq.store(number + 1, std::memory_order_release);
+    }
+
+    bool open(const std::string &path) {
+        close();
+        file = fopen(path.c_str(), "a");
+        if(!file)
+            return false;
+        stopping = false;
+        written = next.load(std::memory_order_acquire) > RECORDS ? next - RECORDS : 0;
+        writer = std::thread([] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!stopping) {
+                wake.wait_for(lock, FLUSH_INTERVAL);
+                flush();
+            }
+        });
+        return true;
+    }
+
+    void close() {
+        if(!writer.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+namespace {
+    constexpr size_t STATUS = 160;
+    char status[STATUS];
+    size_t statusLength = 0;
+}
+
+void setStatus(std::string_view message) {
+    statusLength = std::min(message.size(), STATUS);
+    memcpy(status, message.data(), statusLength);
+}
+
+std::string_view getStatus() {
+    return {status, statusLength};
+}
+
+namespace {
+    void vnotify(logging::Level level, const char *format, va_list args) {
+        char text[logging::TEXT];
+        vsnprintf(text, sizeof text, format, args);
+        if(level >= MINIMA_LOG_LEVEL)
+            logging::write(level, "%s", text);
+
+        // after what's there already, like several messages from one batch of keys
+        if(statusLength > 0 && statusLength < STATUS)
+            status[statusLength++] = ' ';
+        size_t length = std::min(strlen(text), STATUS - statusLength);
+        memcpy(status + statusLength, text, length);
+        statusLength += length;
+    }
+}
+
+void notify(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vnotify(logging::INFO, format, args);
+    va_end(args);
+}
+
+void notify(logging::Level level, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vnotify(level, format, args);
+    va_end(args);
+}
@@ -0,0 +1,70 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_LOG_H
+#define MINIMA_LOG_H
+
+#include <string>
+#include <string_view>
+
+/**
+ * Logging that's cheap enough for hot paths. LOG_INFO("saved %zu lines", n)
+ * formats straight into a fixed-size record in a ring buffer, so it never
+ * allocates. Levels below MINIMA_LOG_LEVEL compile to nothing, arguments
+ * included. The records only reach a file if logging::open was called;
+ * main.cpp does that when MINIMA_LOG names one. A background thread then
+ * writes the records out a few times a second.
+ *
+ * Any thread may log. If the writer falls a whole ring behind, the oldest
+ * records are dropped and the file says how many.
+ */
+namespace logging {
+    enum Level {DEBUG, INFO, WARN, ERROR};
+
+    // longer messages are cut short
+    constexpr size_t TEXT = 112;
+
+    void write(Level level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    /**
+     * Start writing records to `path`, false if it can't be opened
+     */
+    bool open(const std::string &path);
+
+    /**
+     * Write out what's left and stop the writer thread
+     */
+    void close();
+}
+
+// 0 keeps everything, 3 only errors
+#ifndef MINIMA_LOG_LEVEL
+#define MINIMA_LOG_LEVEL 1
+#endif
+
+#define LOG_AT(level, ...) do { \
+        if constexpr(logging::level >= MINIMA_LOG_LEVEL) \
+            logging::write(logging::level, __VA_ARGS__); \
+    } while(0)
+
+#define LOG_DEBUG(...) LOG_AT(DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(ERROR, __VA_ARGS__)
+
+/**
+ * The message on the status bar. It holds a bounded buffer and belongs
+ * to the UI thread.
+ */
+void setStatus(std::string_view message);
+std::string_view getStatus();
+
+/**
+ * Tell the user something on the status bar, after whatever is there
+ * already, and log it at INFO, or at `level` if given
+ */
+void notify(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void notify(logging::Level level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#endif //MINIMA_LOG_H
@@ -0,0 +1,412 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_MATCHINDEX_H
+#define MINIMA_MATCHINDEX_H
+
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <cstdint>
+
+#include "BlockList.h"
+#include "LineStorage.h"
+#include "Search.h"
+#include "Regex.h"
+
+struct SearchTerm {
+    std::string text;
+    bool regex = false;
+    SearchOptions options;
+
+    bool operator==(const SearchTerm &rhs) const {
+        return text == rhs.text && regex == rhs.regex
+               && options.ignoreCase == rhs.options.ignoreCase
+               && options.wholeWord == rhs.options.wholeWord;
+    }
+};
+
+/**
+ * A search term that lists its matches inside one line. Every position a
+ * match starts at counts, overlapping or not, which is the same set
+ * repeated forward searches step through.
+ */
+class LineMatcher {
+    // how far past a window a regex match with no length limit is followed
+    static constexpr size_t REACH = 4096;
+
+    std::optional<LiteralSearch> literal;
+    std::shared_ptr<const Regex> regex;
+
+    LineMatcher() = default;
+
+public:
+    /**
+     * Nothing if the term can't be matched line by line: a bad regex (error
+     * gets set) or a literal containing a newline (error stays empty).
+     * `ownCache` compiles a regex privately instead of sharing the cached
+     * one, which a worker thread needs.
+     */
+    static std::optional<LineMatcher> make(const SearchTerm &term, bool ownCache, std::string &error) {
+        LineMatcher matcher;
+        if(term.regex) {
+            matcher.regex = ownCache ? Regex::compile(term.text, term.options.ignoreCase, error)
+                                     : Regex::cached(term.text, term.options.ignoreCase, error);
+            if(!matcher.regex)
+                return std::nullopt;
+        } else {
+            if(term.text.empty() || term.text.find('\n') != std::string::npos)
+                return std::nullopt;
+            matcher.literal.emplace(term.text, term.options);
+        }
+        return matcher;
+    }
+
+    /**
+     * Calls f(start, end) for each match on the line, in order
+     */
+    template <typename F>
+    void forEach(std::string_view line, F f) const {
+        if(regex) {
+            regex->forEachMatch(line, f);
+            return;
+        }
+        size_t pos = literal->findIn(line, 0);
+        for(; pos != std::string_view::npos; pos = literal->findIn(line, pos + 1))
+            f(pos, pos + literal->size());
+    }
+
+    /**
+     * Calls f(start, end) for each match overlapping columns [from, to), in
+     * order, reading only as far around them as a match can reach. Regex
+     * matches longer than REACH may come out cut short, or not at all.
+     */
+    template <typename F>
+    void forEachOverlapping(std::string_view line, size_t from, size_t to, F f) const {
+        if(regex) {
+            size_t reach = std::min(regex->longest(), REACH);
+            size_t upto = std::min(line.size(), to + reach);
+            regex->forEachMatchIn(line, from > reach ? from - reach : 0, upto, [&](size_t start, size_t end) {
+                if(start < to && end > from)
+                    f(start, end);
+            });
+            return;
+        }
+        // the byte after a match decides a whole word
+        size_t length = literal->size();
+        std::string_view near = line.substr(0, to + length);
+        size_t pos = literal->findIn(near, from >= length ? from - length + 1 : 0);
+        for(; pos != std::string_view::npos && pos < to; pos = literal->findIn(near, pos + 1))
+            f(pos, pos + length);
+    }
+
+    [[nodiscard]]
+    uint32_t count(std::string_view line) const {
+        uint32_t n = 0;
+        forEach(line, [&n](size_t, size_t) { n++; });
+        return n;
+    }
+};
+
+/**
+ * Number of matches of the active search term on every line, kept in a
+ * weighted BlockList so the total, the rank of a match and the k-th match
+ * are all O(log lines) lookups. The first count runs on a worker over a
+ * snapshot of the document; edits made meanwhile are replayed onto its
+ * result once it lands, and after that each edit only recounts the lines
+ * it touched.
+ */
+class MatchIndex {
+    // a line edited while the worker was out, counted again once it's back
+    static constexpr uint32_t STALE = UINT32_MAX;
+
+    struct Weight {
+        size_t operator()(uint32_t n) const {
+            return n == STALE ? 0 : n;
+        }
+    };
+
+    // lines [first, first + removed) were replaced by `added` new ones
+    struct Change {
+        int first, removed, added;
+    };
+
+    std::optional<SearchTerm> term;
+    long termVersion = 0; // bumped whenever the term changes
+    std::optional<LineMatcher> matcher; // for the UI thread
+    BlockList<uint32_t, Weight> counts{};
+    bool ready = false;
+
+    std::thread worker;
+    bool running = false;
+    std::atomic<bool> finished{false};
+    std::atomic<bool> cancelled{false};
+    std::atomic<size_t> scanned{0};
+    std::atomic<size_t> total{0};
+    std::vector<uint32_t> built;
+    std::vector<Change> changes; // made while the worker was running
+
+    void stop() {
+        cancelled = true;
+        if(worker.joinable())
+            worker.join();
+        running = false;
+        changes.clear();
+    }
+
+    void start(const LineStorage &lines, LineMatcher workerMatcher) {
+        finished = false;
+        cancelled = false;
+        scanned = 0;
+        total = 0;
+        running = true;
+
+        // copying the storage only copies block pointers
+        worker = std::thread([this, snapshot = lines, match = std::move(workerMatcher)] {
+            size_t bytes = 0;
+            snapshot.forEachSpan([&bytes](std::string_view span) { bytes += span.size(); });
+            total = bytes;
+
+            std::vector<uint32_t> found;
+            size_t done = 0;
+            snapshot.forEachView([&](std::string_view line) {
+                found.push_back(match.count(line));
+                done += line.size() + 1;
+                scanned.store(done, std::memory_order_relaxed);
+                return !cancelled.load(std::memory_order_relaxed);
+            });
+            built = std::move(found);
+            finished.store(true, std::memory_order_release);
+        });
+    }
+
+    void replace(const LineStorage &lines, const Change &change, bool stale) {
+        counts.erase(change.first, change.first + change.removed);
+        std::vector<uint32_t> fresh(change.added, STALE);
+        if(!stale)
+            for(int i = 0; i < change.added; i++)
+                fresh[i] = matcher->count(lines.at(change.first + i).view());
+        counts.insert(change.first, fresh.begin(), fresh.end());
+    }
+
+    /**
+     * Matches on this line before `chara`, or up to and including it
+     */
+    [[nodiscard]]
+    size_t countBefore(const LineStorage &lines, Point at, bool inclusive) const {
+        size_t n = 0;
+        matcher->forEach(lines.at(at.line).view(), [&](size_t start, size_t) {
+            if((int) start < at.chara || (inclusive && (int) start == at.chara))
+                n++;
+        });
+        return n;
+    }
+
+    [[nodiscard]]
+    Range nth(const LineStorage &lines, size_t rank) const {
+        auto [line, before] = counts.findWeight(rank);
+        size_t skip = rank - before;
+        Range found = Range::empty;
+        matcher->forEach(lines.at(line).view(), [&](size_t start, size_t end) {
+            if(skip-- == 0)
+                found = Range({(int) line, (int) start}, {(int) line, (int) end});
+        });
+        return found;
+    }
+
+public:
+    MatchIndex() = default;
+    MatchIndex(const MatchIndex &) = delete;
+    MatchIndex &operator=(const MatchIndex &) = delete;
+
+    ~MatchIndex() {
+        stop();
+    }
+
+    /**
+     * Make `next` the active term and start counting it, unless it already
+     * is. Terms that can't be indexed just clear the index. Returns false
+     * with error set if the term is a bad regex.
+     */
+    bool setTerm(const SearchTerm &next, const LineStorage &lines, std::string &error) {
+        if(term && *term == next)
+            return true;
+
+        auto made = LineMatcher::make(next, false, error);
+        if(!made) {
+            clear();
+            return error.empty();
+        }
+        stop();
+        termVersion++;
+        term = next;
+        matcher = std::move(made);
+        ready = false;
+        counts.assign({});
+        start(lines, *LineMatcher::make(next, true, error));
+        return true;
+    }
+
+    void clear() {
+        stop();
+        if(term)
+            termVersion++;
+        term.reset();
+        matcher.reset();
+        counts.assign({});
+        ready = false;
+    }
+
+    /**
+     * Changes whenever the term does, so the view knows to redo highlights
+     */
+    [[nodiscard]]
+    long generation() const {
+        return termVersion;
+    }
+
+    [[nodiscard]]
+    bool active() const {
+        return term.has_value();
+    }
+
+    [[nodiscard]]
+    bool isReady() const {
+        return ready;
+    }
+
+    [[nodiscard]]
+    bool busy() const {
+        return running;
+    }
+
+    /**
+     * Pick up the worker's counts once it's done, replaying the edits made
+     * in the meantime. Returns whether the index just became ready.
+     */
+    bool poll(const LineStorage &lines) {
+        if(!running || !finished.load(std::memory_order_acquire))
+            return false;
+        worker.join();
+        running = false;
+
+        counts.assign(std::move(built));
+        built = {};
+        for(const auto &change : changes)
+            replace(lines, change, true);
+
+        if(!changes.empty()) {
+            std::vector<size_t> stale;
+            size_t line = 0;
+            counts.forEach(0, counts.size(), [&](uint32_t n) {
+                if(n == STALE)
+                    stale.push_back(line);
+                line++;
+            });
+            for(size_t i : stale)
+                counts.set(i, matcher->count(lines.at(i).view()));
+            changes.clear();
+        }
+        ready = true;
+        return true;
+    }
+
+    /**
+     * Tell the index lines [first, first + removed) were replaced by
+     * `added` lines, already in place in `lines`
+     */
+    void linesChanged(const LineStorage &lines, int first, int removed, int added) {
+        if(!term)
+            return;
+        if(!ready) {
+            if(running)
+                changes.push_back({first, removed, added});
+            return;
+        }
+        if(removed == 1 && added == 1) {
+            counts.set(first, matcher->count(lines.at(first).view()));
+            return;
+        }
+        replace(lines, {first, removed, added}, false);
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return counts.totalWeight();
+    }
+
+    /**
+     * First match starting at or after `from` when direction > 0, or the
+     * last one starting at or before it otherwise, with its rank. Only
+     * valid once the index is ready.
+     */
+    [[nodiscard]]
+    std::optional<std::pair<Range, size_t>> step(const LineStorage &lines, Point from, int direction) const {
+        size_t before = counts.weightBefore(from.line) + countBefore(lines, from, direction < 0);
+        if(direction < 0) {
+            if(before == 0)
+                return std::nullopt;
+            before--;
+        }
+        if(before >= size())
+            return std::nullopt;
+        return std::make_pair(nth(lines, before), before);
+    }
+
+    /**
+     * Rank of the match starting exactly at `at`, if there is one
+     */
+    [[nodiscard]]
+    std::optional<size_t> rankAt(const LineStorage &lines, Point at) const {
+        if(!ready || counts.at(at.line) == 0)
+            return std::nullopt;
+        std::optional<size_t> rank;
+        size_t index = 0;
+        matcher->forEach(lines.at(at.line).view(), [&](size_t start, size_t) {
+            if((int) start == at.chara)
+                rank = index;
+            index++;
+        });
+        if(rank)
+            *rank += counts.weightBefore(at.line);
+        return rank;
+    }
+
+    /**
+     * Matches on one line overlapping columns [from, to) as [start, end)
+     * columns, for highlighting. Lines the index knows are empty aren't
+     * scanned.
+     */
+    [[nodiscard]]
+    std::vector<std::pair<int, int>> onLine(const LineStorage &lines, int line, int from, int to) const {
+        std::vector<std::pair<int, int>> found;
+        if(!term || (ready && counts.at(line) == 0))
+            return found;
+        matcher->forEachOverlapping(lines.at(line).view(), from, to, [&found](size_t start, size_t end) {
+            found.emplace_back((int) start, (int) end);
+        });
+        return found;
+    }
+
+    /**
+     * "match k of N", the total, or progress while counting
+     */
+    [[nodiscard]]
+    std::string describe(const LineStorage &lines, Point caret) const {
+        if(!term)
+            return "";
+        if(!ready) {
+            size_t all = total;
+            int percent = all > 0 ? (int) (100 * scanned / all) : 0;
+            return "counting matches " + std::to_string(percent) + "%";
+        }
+        if(size() == 0)
+            return "no matches";
+        if(auto rank = rankAt(lines, caret))
+            return "match " + std::to_string(*rank + 1) + " of " + std::to_string(size());
+        return std::to_string(size()) + (size() == 1 ? " match" : " matches");
+    }
+};
+
+#endif //MINIMA_MATCHINDEX_H
@@ -0,0 +1,75 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_OUTPUTMETER_H
+#define MINIMA_OUTPUTMETER_H
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <ncurses.h>
+
+/**
+ * Counts the bytes each screen update sends to the terminal. curses writes
+ * straight to the file descriptor, so this reads the UI thread's own write
+ * counter from /proc before and after refresh(); nothing else on this
+ * thread writes in between. Off unless MINIMA_METER is set.
+ */
+class OutputMeter {
+    bool on;
+    size_t total = 0;
+    size_t last = 0;
+
+public:
+    /**
+     * Bytes this thread has passed to write() so far, -1 if unknown
+     */
+    static long long written() {
+        FILE *io = fopen("/proc/thread-self/io", "r");
+        if(!io)
+            return -1;
+        long long value = -1;
+        char key[32];
+        long long n;
+        while(fscanf(io, "%31s %lld", key, &n) == 2) {
+            if(strcmp(key, "wchar:") == 0) {
+                value = n;
+                break;
+            }
+        }
+        fclose(io);
+        return value;
+    }
+
+    OutputMeter() : on(getenv("MINIMA_METER") != nullptr && written() >= 0) {}
+
+    /**
+     * Push the frame out to the terminal, counting what it took
+     */
+    void refresh() {
+        if(!on) {
+            ::refresh();
+            return;
+        }
+        long long before = written();
+        ::refresh();
+        long long after = written();
+        if(before < 0 || after < before)
+            return;
+        last = after - before;
+        total += last;
+    }
+
+    /**
+     * "sent X KB, last N B", or nothing when off
+     */
+    [[nodiscard]]
+    std::string describe() const {
+        if(!on)
+            return "";
+        return "sent " + std::to_string(total / 1024) + " KB, last " + std::to_string(last) + " B";
+    }
+};
+
+#endif //MINIMA_OUTPUTMETER_H
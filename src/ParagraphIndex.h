@@ -0,0 +1,68 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_PARAGRAPHINDEX_H
+#define MINIMA_PARAGRAPHINDEX_H
+
+#include <cstdint>
+#include <algorithm>
+
+#include "LineCounts.h"
+#include "LineStorage.h"
+#include "Scan.h"
+#include "Structure.h"
+
+/**
+ * Which lines start a paragraph, for the `p` unit: the first line, lines
+ * that start with a tab, and lines under a blank one. Kept as a count of
+ * one or zero per line in LineCounts, so the head of a paragraph and the
+ * head n paragraphs away are Fenwick lookups.
+ */
+class ParagraphIndex {
+    struct Heads {
+        uint32_t operator()(const LineStorage &lines, size_t line) const {
+            if(line == 0)
+                return 1;
+            auto text = lines.at(line).view(), above = lines.at(line - 1).view();
+            return text.substr(0, tab.size()) == tab
+                   || std::all_of(above.begin(), above.end(), scan::detail::isSpace);
+        }
+    };
+
+    LineCounts<Heads> heads{};
+
+public:
+    void reset() {
+        heads.reset();
+    }
+
+    void linesChanged(int first, int removed, int added) {
+        heads.linesChanged(first, removed, added);
+    }
+
+    /**
+     * First line of the paragraph `line` is in
+     */
+    [[nodiscard]]
+    size_t headOf(const LineStorage &lines, size_t line) const {
+        auto found = heads.before(lines, line + 1, 0);
+        return found ? found->first : 0;
+    }
+
+    /**
+     * Head of the paragraph `num` after the one starting at `line`, or
+     * before it if negative. Runs out at the last line and line 0.
+     */
+    [[nodiscard]]
+    size_t step(const LineStorage &lines, size_t line, int num) const {
+        if(num > 0) {
+            auto found = heads.after(lines, line, num - 1);
+            return found ? found->first : lines.size() - 1;
+        }
+        auto found = heads.before(lines, line, -(long) num - 1);
+        return found ? found->first : 0;
+    }
+};
+
+#endif //MINIMA_PARAGRAPHINDEX_H
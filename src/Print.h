@@ -1,68 +0,0 @@
-
-#include <iostream>
-#include <regex>
-
-#ifndef MOVFORTH_PRINT_H
-#define MOVFORTH_PRINT_H
-
-extern std::string status;
-std::string getStatus();
-void setStatus(std::string);
-
-void debug_add(std::basic_string<char> a);
-void debug_add(int a);
-void debug_add(uint a);
-
-template <typename... Args>
-inline void dd(Args&&... args) {
-    (debug_add(std::forward<Args>(args)), ...);
-}
-
-static std::string color_begin = "\\033[1;32m\\n";
-static std::string color_end = "\\033[0m\\n";
-
-static int indents;
-
-static std::string tab_string = "\n";
-
-// Debug toggle - not the best, but works for now
-static const bool debug = true;
-
-std::string newlines_have_indents(const std::string& in);
-
-void regen_tab();
-
-void indent();
-
-void unindent();
-
-void print_single(std::basic_string<char> arg);
-void print_single(int arg);
-
-template <typename... Args>
-inline void print(Args&&... args) {
-    (print_single(std::forward<Args>(args)), ...);
-}
-
-template <typename... Args>
-inline void println0(Args&&... args){
-    print("\n", args...);
-}
-
-template <typename... Args>
-inline void println(Args&&... args){
-    println0(args...);
-}
-template <typename... Args>
-inline void dln(Args&&... args){
-    if(debug)
-        println(args...);
-}
-
-template <typename... Args>
-inline void d(Args&&... args){
-    if(debug)
-        print(args...);
-}
-
-#endif
\ No newline at end of file
@@ -0,0 +1,794 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_REGEX_H
+#define MINIMA_REGEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <memory>
+#include <map>
+#include <list>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+#include "Structure.h"
+#include "LineStorage.h"
+
+/**
+ * Regular expressions compiled to a lazily built DFA, so matching is linear
+ * in the line length no matter the pattern: there is no backtracking.
+ * Matches stay within one line and are leftmost-longest.
+ *
+ * Syntax: literals, . [] [^] * + ? {n} {n,} {n,m} | () ^ $ and the escapes
+ * \d \w \s \D \W \S \t plus \ before any metacharacter.
+ */
+class Regex {
+public:
+    // bytes, plus markers fed before and after a line so ^ and $ are plain symbols
+    static constexpr int BOL = 256, EOL = 257, SYMBOLS = 258;
+    using Symbols = std::bitset<SYMBOLS>;
+
+private:
+    /* Parsing */
+
+    struct Node {
+        enum Type {SET, EMPTY, CONCAT, ALT, STAR, PLUS, QUEST};
+        Type type;
+        Symbols set{};
+        std::vector<std::unique_ptr<Node>> kids{};
+
+        [[nodiscard]]
+        size_t size() const {
+            size_t count = 1;
+            for(const auto &kid : kids)
+                count += kid->size();
+            return count;
+        }
+
+        [[nodiscard]]
+        std::unique_ptr<Node> clone() const {
+            auto copy = std::make_unique<Node>(Node{type, set, {}});
+            for(const auto &kid : kids)
+                copy->kids.push_back(kid->clone());
+            return copy;
+        }
+
+        /**
+         * Most bytes a match can take, SIZE_MAX if there's no limit
+         */
+        [[nodiscard]]
+        size_t longest() const {
+            size_t most = 0;
+            switch(type) {
+                case SET:
+                    return 1; // ^ and $ take none, counting them only overshoots
+                case EMPTY:
+                    return 0;
+                case STAR:
+                case PLUS:
+                    return SIZE_MAX;
+                case QUEST:
+                    return kids.front()->longest();
+                case CONCAT:
+                    for(const auto &kid : kids) {
+                        size_t length = kid->longest();
+                        if(length >= SIZE_MAX - most)
+                            return SIZE_MAX;
+                        most += length;
+                    }
+                    return most;
+                case ALT:
+                    for(const auto &kid : kids)
+                        most = std::max(most, kid->longest());
+                    return most;
+            }
+            return SIZE_MAX;
+        }
+    };
+    using NodePtr = std::unique_ptr<Node>;
+
+    class Parser {
+        // nested counts multiply, so {} copies are capped as a whole
+        static constexpr size_t MOST_COPIED = 100000;
+
+        std::string_view pattern;
+        size_t pos = 0;
+        bool ignoreCase;
+        size_t copied = 0;
+
+        static NodePtr make(Node::Type type) {
+            return std::make_unique<Node>(Node{type});
+        }
+        static NodePtr makeSet(const Symbols &set) {
+            auto node = make(Node::SET);
+            node->set = set;
+            return node;
+        }
+
+        [[nodiscard]]
+        bool more() const {
+            return pos < pattern.size();
+        }
+
+        void addChar(Symbols &set, unsigned char c) const {
+            set.set(c);
+            if(ignoreCase && std::isalpha(c))
+                set.set(std::islower(c) ? std::toupper(c) : std::tolower(c));
+        }
+
+        static Symbols classFor(char name) {
+            Symbols set;
+            for(int c = 0; c < 256; c++) {
+                bool in = false;
+                switch(std::tolower(name)) {
+                    case 'd': in = std::isdigit(c); break;
+                    case 'w': in = std::isalnum(c) || c == '_'; break;
+                    case 's': in = c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; break;
+                    default: break;
+                }
+                if(std::isupper(name)) in = !in;
+                if(in) set.set(c);
+            }
+            return set;
+        }
+
+        static bool isClassEscape(char c) {
+            return std::string_view("dwsDWS").find(c) != std::string_view::npos;
+        }
+
+        static char unescape(char c) {
+            return c == 't' ? '\t' : c == 'n' ? '\n' : c;
+        }
+
+        NodePtr parseClass() {
+            // just past the '['
+            Symbols set;
+            bool negate = more() && pattern[pos] == '^';
+            if(negate) pos++;
+
+            bool first = true;
+            while(more() && (pattern[pos] != ']' || first)) {
+                first = false;
+                char c = pattern[pos++];
+                if(c == '\\' && more()) {
+                    char e = pattern[pos++];
+                    if(isClassEscape(e)) {
+                        set |= classFor(e);
+                        continue;
+                    }
+                    c = unescape(e);
+                }
+                // range
+                if(pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+                    char hi = pattern[pos + 1];
+                    pos += 2;
+                    if(hi == '\\' && more())
+                        hi = unescape(pattern[pos++]);
+                    if((unsigned char) hi < (unsigned char) c)
+                        throw std::runtime_error("bad range in []");
+                    for(int x = (unsigned char) c; x <= (unsigned char) hi; x++)
+                        addChar(set, x);
+                    continue;
+                }
+                addChar(set, c);
+            }
+            if(!more())
+                throw std::runtime_error("missing ]");
+            pos++; // ']'
+
+            if(negate) {
+                set.flip();
+                set.reset(BOL);
+                set.reset(EOL);
+            }
+            return makeSet(set);
+        }
+
+        NodePtr parseAtom() {
+            char c = pattern[pos++];
+            switch(c) {
+                case '(': {
+                    auto inner = parseAlt();
+                    if(!more() || pattern[pos] != ')')
+                        throw std::runtime_error("missing )");
+                    pos++;
+                    return inner;
+                }
+                case '[':
+                    return parseClass();
+                case '.': {
+                    Symbols set;
+                    for(int x = 0; x < 256; x++) set.set(x);
+                    set.reset('\n');
+                    return makeSet(set);
+                }
+                case '^': {
+                    Symbols set;
+                    set.set(BOL);
+                    return makeSet(set);
+                }
+                case '$': {
+                    Symbols set;
+                    set.set(EOL);
+                    return makeSet(set);
+                }
+                case '\\': {
+                    if(!more())
+                        throw std::runtime_error("trailing \\");
+                    char e = pattern[pos++];
+                    if(isClassEscape(e))
+                        return makeSet(classFor(e));
+                    Symbols set;
+                    addChar(set, unescape(e));
+                    return makeSet(set);
+                }
+                case '*':
+                case '+':
+                case '?':
+                    throw std::runtime_error("nothing to repeat");
+                default: {
+                    Symbols set;
+                    addChar(set, c);
+                    return makeSet(set);
+                }
+            }
+        }
+
+        /**
+         * Reads {n}, {n,} or {n,m} if that's what follows, otherwise leaves
+         * pos alone so the brace is taken literally
+         */
+        bool parseBounds(int &low, int &high) {
+            size_t at = pos + 1;
+            auto number = [&](int &out) {
+                size_t begin = at;
+                out = 0;
+                while(at < pattern.size() && std::isdigit(pattern[at]) && at - begin < 5)
+                    out = out * 10 + (pattern[at++] - '0');
+                return at > begin;
+            };
+            if(!number(low))
+                return false;
+            high = low;
+            if(at < pattern.size() && pattern[at] == ',') {
+                at++;
+                if(!number(high))
+                    high = -1; // unbounded
+            }
+            if(at >= pattern.size() || pattern[at] != '}')
+                return false;
+            if(high != -1 && high < low)
+                throw std::runtime_error("bad {} bounds");
+            if(std::max(low, high) > 1000)
+                throw std::runtime_error("repeat count too big");
+            pos = at + 1;
+            return true;
+        }
+
+        NodePtr repeat(NodePtr atom, int low, int high) {
+            copied += atom->size() * std::max(low, high);
+            if(copied > MOST_COPIED)
+                throw std::runtime_error("pattern too big");
+            auto seq = make(Node::CONCAT);
+            for(int i = 0; i < low; i++)
+                seq->kids.push_back(atom->clone());
+            if(high == -1) {
+                auto star = make(Node::STAR);
+                star->kids.push_back(std::move(atom));
+                seq->kids.push_back(std::move(star));
+            } else {
+                for(int i = low; i < high; i++) {
+                    auto quest = make(Node::QUEST);
+                    quest->kids.push_back(atom->clone());
+                    seq->kids.push_back(std::move(quest));
+                }
+            }
+            return seq;
+        }
+
+        NodePtr parseRepeat() {
+            auto atom = parseAtom();
+            while(more()) {
+                char c = pattern[pos];
+                Node::Type type;
+                if(c == '*') type = Node::STAR;
+                else if(c == '+') type = Node::PLUS;
+                else if(c == '?') type = Node::QUEST;
+                else if(c == '{') {
+                    int low, high;
+                    if(!parseBounds(low, high))
+                        break;
+                    atom = repeat(std::move(atom), low, high);
+                    continue;
+                }
+                else break;
+                pos++;
+                auto wrapped = make(type);
+                wrapped->kids.push_back(std::move(atom));
+                atom = std::move(wrapped);
+            }
+            return atom;
+        }
+
+        NodePtr parseConcat() {
+            auto seq = make(Node::CONCAT);
+            while(more() && pattern[pos] != '|' && pattern[pos] != ')')
+                seq->kids.push_back(parseRepeat());
+            if(seq->kids.empty())
+                return make(Node::EMPTY);
+            return seq;
+        }
+
+        NodePtr parseAlt() {
+            auto alt = make(Node::ALT);
+            alt->kids.push_back(parseConcat());
+            while(more() && pattern[pos] == '|') {
+                pos++;
+                alt->kids.push_back(parseConcat());
+            }
+            if(alt->kids.size() == 1)
+                return std::move(alt->kids.front());
+            return alt;
+        }
+
+    public:
+        Parser(std::string_view pattern, bool ignoreCase) : pattern(pattern), ignoreCase(ignoreCase) {}
+
+        NodePtr parse() {
+            auto root = parseAlt();
+            if(more())
+                throw std::runtime_error("unmatched )");
+            return root;
+        }
+    };
+
+    /* Thompson NFA */
+
+    struct NfaState {
+        enum Kind {SET, EPS, SPLIT, MATCH};
+        Kind kind;
+        Symbols set{};
+        int out = -1, out1 = -1;
+    };
+
+    struct Nfa {
+        std::vector<NfaState> states;
+        int start = -1;
+    };
+
+    struct Frag {
+        int start;
+        std::vector<std::pair<int, int>> outs; // (state, which out) left dangling
+    };
+
+    static int add(Nfa &nfa, NfaState state) {
+        nfa.states.push_back(state);
+        return (int) nfa.states.size() - 1;
+    }
+
+    static void patch(Nfa &nfa, const std::vector<std::pair<int, int>> &outs, int target) {
+        for(auto [state, which] : outs)
+            (which == 0 ? nfa.states[state].out : nfa.states[state].out1) = target;
+    }
+
+    static Frag compile(Nfa &nfa, const Node &node, bool reverse) {
+        switch(node.type) {
+            case Node::SET: {
+                int s = add(nfa, {NfaState::SET, node.set});
+                return {s, {{s, 0}}};
+            }
+            case Node::EMPTY: {
+                int s = add(nfa, {NfaState::EPS});
+                return {s, {{s, 0}}};
+            }
+            case Node::CONCAT: {
+                std::vector<const Node *> order;
+                for(const auto &kid : node.kids) order.push_back(kid.get());
+                if(reverse) std::reverse(order.begin(), order.end());
+                if(order.empty()) {
+                    int s = add(nfa, {NfaState::EPS});
+                    return {s, {{s, 0}}};
+                }
+                Frag frag = compile(nfa, *order.front(), reverse);
+                for(size_t i = 1; i < order.size(); i++) {
+                    Frag next = compile(nfa, *order[i], reverse);
+                    patch(nfa, frag.outs, next.start);
+                    frag.outs = std::move(next.outs);
+                }
+                return frag;
+            }
+            case Node::ALT: {
+                Frag frag = compile(nfa, *node.kids.front(), reverse);
+                for(size_t i = 1; i < node.kids.size(); i++) {
+                    Frag next = compile(nfa, *node.kids[i], reverse);
+                    int s = add(nfa, {NfaState::SPLIT});
+                    nfa.states[s].out = frag.start;
+                    nfa.states[s].out1 = next.start;
+                    frag.start = s;
+                    frag.outs.insert(frag.outs.end(), next.outs.begin(), next.outs.end());
+                }
+                return frag;
+            }
+            case Node::STAR: {
+                Frag inner = compile(nfa, *node.kids.front(), reverse);
+                int s = add(nfa, {NfaState::SPLIT});
+                nfa.states[s].out = inner.start;
+                patch(nfa, inner.outs, s);
+                return {s, {{s, 1}}};
+            }
+            case Node::PLUS: {
+                Frag inner = compile(nfa, *node.kids.front(), reverse);
+                int s = add(nfa, {NfaState::SPLIT});
+                nfa.states[s].out = inner.start;
+                patch(nfa, inner.outs, s);
+                return {inner.start, {{s, 1}}};
+            }
+            case Node::QUEST: {
+                Frag inner = compile(nfa, *node.kids.front(), reverse);
+                int s = add(nfa, {NfaState::SPLIT});
+                nfa.states[s].out = inner.start;
+                inner.outs.emplace_back(s, 1);
+                return {s, inner.outs};
+            }
+        }
+        return {};
+    }
+
+    static Nfa build(const Node &root, bool reverse) {
+        Nfa nfa;
+        Frag frag = compile(nfa, root, reverse);
+        int match = add(nfa, {NfaState::MATCH});
+        patch(nfa, frag.outs, match);
+        nfa.start = frag.start;
+        return nfa;
+    }
+
+    /* Lazy DFA */
+
+    /**
+     * DFA states are built the first time a transition needs them and kept,
+     * so repeated searches with the same pattern only walk a table. If the
+     * cache grows past its budget it is dropped and rebuilt from the state
+     * currently in use.
+     */
+    class Dfa {
+        static constexpr size_t MAX_STATES = 2048;
+
+        const Nfa &nfa;
+        bool unanchored; // re-enter the start state at every position
+
+        std::map<std::vector<int>, int> ids;
+        std::vector<std::vector<int>> sets;
+        std::vector<char> matching;
+        std::vector<int> next; // SYMBOLS entries per state, -1 until computed
+
+        void closure(int state, std::vector<char> &seen, std::vector<int> &out) const {
+            if(state < 0 || seen[state]) return;
+            seen[state] = 1;
+            const auto &s = nfa.states[state];
+            if(s.kind == NfaState::EPS) {
+                closure(s.out, seen, out);
+            } else if(s.kind == NfaState::SPLIT) {
+                closure(s.out, seen, out);
+                closure(s.out1, seen, out);
+            } else {
+                out.push_back(state);
+            }
+        }
+
+        int intern(std::vector<int> set) {
+            std::sort(set.begin(), set.end());
+            auto found = ids.find(set);
+            if(found != ids.end())
+                return found->second;
+
+            int id = (int) sets.size();
+            bool match = false;
+            for(int s : set)
+                match |= nfa.states[s].kind == NfaState::MATCH;
+            ids.emplace(set, id);
+            sets.push_back(std::move(set));
+            matching.push_back(match);
+            next.resize(next.size() + SYMBOLS, -1);
+            return id;
+        }
+
+        void reset() {
+            ids.clear();
+            sets.clear();
+            matching.clear();
+            next.clear();
+        }
+
+    public:
+        Dfa(const Nfa &nfa, bool unanchored) : nfa(nfa), unanchored(unanchored) {}
+
+        int start() {
+            std::vector<char> seen(nfa.states.size());
+            std::vector<int> set;
+            closure(nfa.start, seen, set);
+            return intern(std::move(set));
+        }
+
+        [[nodiscard]]
+        bool isMatch(int state) const {
+            return matching[state];
+        }
+
+        [[nodiscard]]
+        bool isDead(int state) const {
+            return sets[state].empty();
+        }
+
+        /**
+         * Feed bytes from `begin` towards `end` (backwards if end < begin)
+         * until a matching state comes up. Returns where it stopped: the byte
+         * that led to the match, or `end`. Transitions already in the table are
+         * taken without leaving the loop.
+         */
+        const unsigned char *runUntilMatch(int &state, const unsigned char *begin, const unsigned char *end) {
+            int direction = end < begin ? -1 : 1;
+            const unsigned char *p = begin;
+            while(p != end) {
+                int known = next[(size_t) state * SYMBOLS + *p];
+                state = known >= 0 ? known : step(state, *p);
+                if(matching[state])
+                    return p;
+                p += direction;
+            }
+            return end;
+        }
+
+        /**
+         * The state after either taking `symbol` or not. Used to feed BOL to
+         * the anchored DFA, where patterns without ^ have to skip it.
+         */
+        int optionally(int state, int symbol) {
+            std::vector<int> merged = sets[state];
+            int stepped = step(state, symbol); // may reset the cache, so copy first
+            merged.insert(merged.end(), sets[stepped].begin(), sets[stepped].end());
+            std::sort(merged.begin(), merged.end());
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+            return intern(std::move(merged));
+        }
+
+        int step(int state, int symbol) {
+            int known = next[(size_t) state * SYMBOLS + symbol];
+            if(known >= 0)
+                return known;
+
+            if(sets.size() >= MAX_STATES) {
+                std::vector<int> current = sets[state];
+                reset();
+                state = intern(std::move(current));
+            }
+
+            std::vector<char> seen(nfa.states.size());
+            std::vector<int> target;
+            for(int s : sets[state]) {
+                const auto &ns = nfa.states[s];
+                if(ns.kind == NfaState::SET && ns.set.test(symbol))
+                    closure(ns.out, seen, target);
+            }
+            if(unanchored)
+                closure(nfa.start, seen, target);
+
+            int id = intern(std::move(target));
+            next[(size_t) state * SYMBOLS + symbol] = id;
+            return id;
+        }
+    };
+
+    std::string pattern;
+    bool ignoreCase;
+    Nfa forwardNfa, reverseNfa;
+    size_t maxLength;
+    // mutable: the DFAs fill in as they're used, which doesn't change what matches
+    mutable std::unique_ptr<Dfa> search, anchored, backward;
+
+    Regex(std::string pattern, bool ignoreCase, const Node &root)
+            : pattern(std::move(pattern)), ignoreCase(ignoreCase),
+              forwardNfa(build(root, false)), reverseNfa(build(root, true)), maxLength(root.longest()) {
+        search = std::make_unique<Dfa>(forwardNfa, true);
+        anchored = std::make_unique<Dfa>(forwardNfa, false);
+        backward = std::make_unique<Dfa>(reverseNfa, true);
+    }
+
+    /**
+     * Whether anything in line[from..] matches, stopping at the first hit
+     */
+    [[nodiscard]]
+    bool anyMatch(std::string_view line, size_t from) const {
+        int state = search->start();
+        if(from == 0) state = search->step(state, BOL);
+        if(search->isMatch(state)) return true;
+        auto *begin = (const unsigned char *) line.data();
+        auto *end = begin + line.size();
+        if(search->runUntilMatch(state, begin + from, end) != end) return true;
+        return search->isMatch(search->step(state, EOL));
+    }
+
+    /**
+     * Walks line[from, upto) backwards with the reversed pattern, calling
+     * found(i) for each i >= from where a match ending by `upto` starts,
+     * highest first, until it returns false
+     */
+    template <typename F>
+    void matchStarts(std::string_view line, size_t from, size_t upto, F found) const {
+        int state = backward->start();
+        if(upto == line.size()) {
+            state = backward->step(state, EOL);
+            if(backward->isMatch(state) && !found(line.size())) return;
+        }
+        auto *data = (const unsigned char *) line.data();
+        const unsigned char *stop = data + from - 1; // one before the last byte to read
+        for(const unsigned char *p = data + upto - 1; p != stop; p--) {
+            p = backward->runUntilMatch(state, p, stop);
+            if(p == stop) break;
+            if(!found(p - data)) return;
+        }
+        if(from == 0 && backward->isMatch(backward->step(state, BOL)))
+            found(0);
+    }
+
+    /**
+     * End of the longest match starting exactly at `start` and ending by
+     * `upto`
+     */
+    [[nodiscard]]
+    size_t longestEnd(std::string_view line, size_t start, size_t upto) const {
+        int state = anchored->start();
+        if(start == 0) state = anchored->optionally(state, BOL);
+        size_t end = start;
+        for(size_t i = start; i < upto && !anchored->isDead(state); i++) {
+            state = anchored->step(state, (unsigned char) line[i]);
+            if(anchored->isMatch(state)) end = i + 1;
+        }
+        if(upto == line.size() && !anchored->isDead(state) && anchored->isMatch(anchored->step(state, EOL)))
+            end = line.size();
+        return end;
+    }
+
+public:
+    /**
+     * Compile a fresh copy with its own DFA cache, for use on another thread.
+     * Returns nullptr and sets error if it doesn't parse.
+     */
+    static std::shared_ptr<const Regex> compile(const std::string &pattern, bool ignoreCase, std::string &error) {
+        try {
+            auto root = Parser(pattern, ignoreCase).parse();
+            return std::shared_ptr<const Regex>(new Regex(pattern, ignoreCase, *root));
+        } catch(const std::runtime_error &e) {
+            error = std::string("Bad regex: ") + e.what();
+            return nullptr;
+        }
+    }
+
+    /**
+     * Compile a pattern, or reuse the compiled copy (and its DFA cache) if it
+     * was used recently. Returns nullptr and sets error if it doesn't parse.
+     */
+    static std::shared_ptr<const Regex> cached(const std::string &pattern, bool ignoreCase, std::string &error) {
+        static constexpr size_t KEEP = 8;
+        static std::list<std::shared_ptr<const Regex>> recent;
+
+        for(auto it = recent.begin(); it != recent.end(); it++) {
+            if((*it)->pattern == pattern && (*it)->ignoreCase == ignoreCase) {
+                recent.splice(recent.begin(), recent, it);
+                return recent.front();
+            }
+        }
+
+        auto regex = compile(pattern, ignoreCase, error);
+        if(!regex)
+            return nullptr;
+        recent.push_front(std::move(regex));
+        if(recent.size() > KEEP)
+            recent.pop_back();
+        return recent.front();
+    }
+
+    /**
+     * Leftmost-longest match starting at or after `from`, as [start, end)
+     */
+    [[nodiscard]]
+    std::optional<std::pair<size_t, size_t>> findIn(std::string_view line, size_t from) const {
+        if(from > line.size() || !anyMatch(line, from))
+            return std::nullopt;
+        size_t start = line.size();
+        matchStarts(line, from, line.size(), [&start](size_t i) {
+            start = i;
+            return true;
+        });
+        return std::make_pair(start, longestEnd(line, start, line.size()));
+    }
+
+    /**
+     * Longest match with the last start at or before `upto`
+     */
+    [[nodiscard]]
+    std::optional<std::pair<size_t, size_t>> findLastIn(std::string_view line, size_t upto) const {
+        std::optional<size_t> start;
+        matchStarts(line, 0, line.size(), [&start, upto](size_t i) {
+            if(i > upto)
+                return true;
+            start = i;
+            return false;
+        });
+        if(!start)
+            return std::nullopt;
+        return std::make_pair(*start, longestEnd(line, *start, line.size()));
+    }
+
+    /**
+     * Calls f(start, end) for the longest non-empty match at every position
+     * one can start, in order. Overlapping matches are all reported, the
+     * same set repeated forward searches would step through.
+     */
+    template <typename F>
+    void forEachMatch(std::string_view line, F f) const {
+        if(anyMatch(line, 0))
+            forEachMatchIn(line, 0, line.size(), f);
+    }
+
+    /**
+     * forEachMatch over line[from, upto) only: matches that start and end
+     * in there, each as long as it gets by `upto`
+     */
+    template <typename F>
+    void forEachMatchIn(std::string_view line, size_t from, size_t upto, F f) const {
+        std::vector<size_t> starts;
+        matchStarts(line, from, upto, [&starts](size_t i) {
+            if(starts.empty() || starts.back() != i) // 0 can come up again after BOL
+                starts.push_back(i);
+            return true;
+        });
+        for(auto it = starts.rbegin(); it != starts.rend(); it++) {
+            size_t end = longestEnd(line, *it, upto);
+            if(end > *it)
+                f(*it, end);
+        }
+    }
+
+    /**
+     * Most bytes a match can take, SIZE_MAX if there's no limit
+     */
+    [[nodiscard]]
+    size_t longest() const {
+        return maxLength;
+    }
+
+    /**
+     * First match starting at or after `from` when direction > 0, or the
+     * last one starting at or before it otherwise
+     */
+    [[nodiscard]]
+    std::optional<Range> find(const LineStorage &lines, Point from, int direction) const {
+        std::optional<Range> result;
+        auto visit = [&](size_t number, const Line &line) {
+            bool first = (int) number == from.line;
+            std::optional<std::pair<size_t, size_t>> hit;
+            if(direction > 0)
+                hit = findIn(line.view(), first ? from.chara : 0);
+            else
+                hit = findLastIn(line.view(), first ? from.chara : std::string_view::npos);
+            if(hit)
+                result = Range({(int) number, (int) hit->first}, {(int) number, (int) hit->second});
+            return !result;
+        };
+
+        if(direction > 0)
+            lines.scanForward(from.line, visit);
+        else
+            lines.scanBackward(from.line, visit);
+        return result;
+    }
+};
+
+#endif //MINIMA_REGEX_H
@@ -0,0 +1,93 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_SAVEWORKER_H
+#define MINIMA_SAVEWORKER_H
+
+#include <thread>
+#include <atomic>
+#include <optional>
+
+#include "FileWriter.h"
+
+/**
+ * Writes a snapshot of the document on its own thread, so the UI keeps
+ * taking keys while a big file goes out. The snapshot shares its blocks
+ * with the live document, and edits made during the save clone the
+ * blocks they touch instead of changing what is being written.
+ */
+class SaveWorker {
+    std::thread worker;
+    std::atomic<bool> finished{false};
+    std::atomic<size_t> written{0};
+    std::atomic<size_t> total{0};
+    SaveReport report;
+    long version = 0;
+    bool running = false;
+
+public:
+    SaveWorker() = default;
+    SaveWorker(const SaveWorker &) = delete;
+    SaveWorker &operator=(const SaveWorker &) = delete;
+
+    ~SaveWorker() {
+        wait();
+    }
+
+    [[nodiscard]]
+    bool busy() const {
+        return running;
+    }
+
+    /**
+     * `snapshotVersion` is handed back by poll() so the caller can tell
+     * whether edits landed after the snapshot was taken
+     */
+    void start(const std::string &path, LineStorage snapshot, long snapshotVersion) {
+        wait();
+        finished = false;
+        written = 0;
+        total = 0;
+        version = snapshotVersion;
+        running = true;
+
+        worker = std::thread([this, path, lines = std::move(snapshot)] {
+            size_t bytes = 0;
+            lines.forEachSpan([&bytes](std::string_view span) { bytes += span.size(); });
+            total = bytes;
+
+            report = FileWriter::save(path, lines, &written);
+            finished.store(true, std::memory_order_release);
+        });
+    }
+
+    /**
+     * The report and snapshot version once the save is done, nothing while
+     * it is still running
+     */
+    std::optional<std::pair<SaveReport, long>> poll() {
+        if(!running || !finished.load(std::memory_order_acquire))
+            return std::nullopt;
+        worker.join();
+        running = false;
+        return std::make_pair(report, version);
+    }
+
+    [[nodiscard]]
+    std::string describeProgress() const {
+        size_t bytes = written, all = total;
+        int percent = all > 0 ? (int) (100 * bytes / all) : 0;
+        char buf[64];
+        snprintf(buf, sizeof buf, "Saving... %d%% (%.1f MB)", percent, (double) bytes / 1e6);
+        return buf;
+    }
+
+    void wait() {
+        if(worker.joinable())
+            worker.join();
+        running = false;
+    }
+};
+
+#endif //MINIMA_SAVEWORKER_H
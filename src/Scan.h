@@ -0,0 +1,282 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_SCAN_H
+#define MINIMA_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MINIMA_SCAN_X86
+#endif
+
+/**
+ * Vectorized byte scanning, used everywhere text gets split into lines or
+ * words. The widest instruction set the CPU supports is picked on first use.
+ */
+namespace scan {
+
+namespace detail {
+
+using PositionsFn = size_t (*)(const char *, const char *, char, size_t *, size_t);
+using CountFn = size_t (*)(const char *, const char *, char);
+
+inline size_t positionsScalar(const char *begin, const char *end, char c, size_t *out, size_t max) {
+    size_t found = 0;
+    for(const char *p = begin; p < end && found < max; p++)
+        if(*p == c)
+            out[found++] = p - begin;
+    return found;
+}
+
+inline size_t countScalar(const char *begin, const char *end, char c) {
+    size_t found = 0;
+    for(const char *p = begin; p < end; p++)
+        found += *p == c;
+    return found;
+}
+
+// whitespace as isspace sees it in the C locale
+inline bool isSpace(char c) {
+    return c == ' ' || (unsigned char) (c - 9) < 5;
+}
+
+using SpaceMaskFn = uint32_t (*)(const char *);
+
+// bit i set when p[i] is whitespace, for n <= 32 bytes
+inline uint32_t spaceMaskScalar(const char *p, size_t n) {
+    uint32_t mask = 0;
+    for(size_t i = 0; i < n; i++)
+        mask |= (uint32_t) isSpace(p[i]) << i;
+    return mask;
+}
+
+inline uint32_t spaceMask32Scalar(const char *p) {
+    return spaceMaskScalar(p, 32);
+}
+
+#ifdef MINIMA_SCAN_X86
+
+// pull set bits of a compare mask out as offsets
+#define MINIMA_SCAN_EMIT(mask, base)                 \
+    while(mask) {                                    \
+        out[found++] = (base) + __builtin_ctz(mask); \
+        if(found == max) return found;               \
+        mask &= mask - 1;                            \
+    }
+
+__attribute__((target("sse2")))
+inline size_t positionsSse2(const char *begin, const char *end, char c, size_t *out, size_t max) {
+    size_t found = 0, i = 0, len = end - begin;
+    if(max == 0) return 0;
+    __m128i needle = _mm_set1_epi8(c);
+    for(; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (begin + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        MINIMA_SCAN_EMIT(mask, i)
+    }
+    size_t tail = positionsScalar(begin + i, end, c, out + found, max - found);
+    for(size_t k = found; k < found + tail; k++) out[k] += i;
+    return found + tail;
+}
+
+__attribute__((target("avx2")))
+inline size_t positionsAvx2(const char *begin, const char *end, char c, size_t *out, size_t max) {
+    size_t found = 0, i = 0, len = end - begin;
+    if(max == 0) return 0;
+    __m256i needle = _mm256_set1_epi8(c);
+    for(; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) (begin + i));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        MINIMA_SCAN_EMIT(mask, i)
+    }
+    size_t tail = positionsScalar(begin + i, end, c, out + found, max - found);
+    for(size_t k = found; k < found + tail; k++) out[k] += i;
+    return found + tail;
+}
+
+#undef MINIMA_SCAN_EMIT
+
+__attribute__((target("sse2")))
+inline size_t countSse2(const char *begin, const char *end, char c) {
+    size_t found = 0, i = 0, len = end - begin;
+    __m128i needle = _mm_set1_epi8(c);
+    for(; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (begin + i));
+        found += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    }
+    return found + countScalar(begin + i, end, c);
+}
+
+__attribute__((target("avx2,popcnt")))
+inline size_t countAvx2(const char *begin, const char *end, char c) {
+    size_t found = 0, i = 0, len = end - begin;
+    __m256i needle = _mm256_set1_epi8(c);
+    for(; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) (begin + i));
+        found += __builtin_popcount((unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    }
+    return found + countScalar(begin + i, end, c);
+}
+
+__attribute__((target("sse2")))
+inline uint32_t spaceMask32Sse2(const char *p) {
+    uint32_t mask = 0;
+    for(int half = 0; half < 2; half++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (p + 16 * half));
+        // \t through \r are the five bytes from 9, so c - 9 <= 4 unsigned
+        __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8(9));
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+        __m128i space = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+        mask |= (uint32_t) _mm_movemask_epi8(_mm_or_si128(control, space)) << (16 * half);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+inline uint32_t spaceMask32Avx2(const char *p) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *) p);
+    __m256i shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8(9));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+    __m256i space = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '));
+    return (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(control, space));
+}
+
+#endif
+
+inline PositionsFn pickPositions() {
+#ifdef MINIMA_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return positionsAvx2;
+    if(__builtin_cpu_supports("sse2")) return positionsSse2;
+#endif
+    return positionsScalar;
+}
+
+inline SpaceMaskFn pickSpaceMask() {
+#ifdef MINIMA_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return spaceMask32Avx2;
+    if(__builtin_cpu_supports("sse2")) return spaceMask32Sse2;
+#endif
+    return spaceMask32Scalar;
+}
+
+/**
+ * Calls f(offset, edges) for each 32 byte window of [begin, end), where bit
+ * i of edges is set if byte offset + i is whitespace and the one before it
+ * isn't, or the other way round. The byte before begin counts as
+ * whitespace if `spaceBefore`. Stops when f returns false.
+ */
+template <typename F>
+void forEachEdgeMask(const char *begin, const char *end, bool spaceBefore, F f) {
+    static const SpaceMaskFn fn = pickSpaceMask();
+    uint32_t before = spaceBefore;
+    size_t len = end - begin;
+    for(size_t i = 0; i < len; i += 32) {
+        size_t n = std::min<size_t>(32, len - i);
+        uint32_t mask = n == 32 ? fn(begin + i) : spaceMaskScalar(begin + i, n);
+        uint32_t edges = mask ^ ((mask << 1) | before);
+        if(n < 32)
+            edges &= (1u << n) - 1;
+        before = mask >> 31;
+        if(!f(i, edges))
+            return;
+    }
+}
+
+inline CountFn pickCount() {
+#ifdef MINIMA_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return countAvx2;
+    if(__builtin_cpu_supports("sse2")) return countSse2;
+#endif
+    return countScalar;
+}
+
+}
+
+/**
+ * Write the offsets (from begin) of up to `max` occurrences of c into out.
+ * Returns how many were written; if that's max, resume after the last one.
+ */
+inline size_t positions(const char *begin, const char *end, char c, size_t *out, size_t max) {
+    static const detail::PositionsFn fn = detail::pickPositions();
+    return fn(begin, end, c, out, max);
+}
+
+inline size_t count(const char *begin, const char *end, char c) {
+    static const detail::CountFn fn = detail::pickCount();
+    return fn(begin, end, c);
+}
+
+/**
+ * Number of places in [begin, end) where the text switches between
+ * whitespace and not, the byte before begin taken as whitespace if
+ * `spaceBefore`. A word fully inside the range accounts for two.
+ */
+inline size_t wordEdges(const char *begin, const char *end, bool spaceBefore = true) {
+    size_t found = 0;
+    detail::forEachEdgeMask(begin, end, spaceBefore, [&found](size_t, uint32_t edges) {
+        found += __builtin_popcount(edges);
+        return true;
+    });
+    return found;
+}
+
+/**
+ * Offset from begin of the n-th (from 0) of those switches, or SIZE_MAX if
+ * there aren't that many
+ */
+inline size_t nthWordEdge(const char *begin, const char *end, size_t n, bool spaceBefore = true) {
+    size_t at = SIZE_MAX;
+    detail::forEachEdgeMask(begin, end, spaceBefore, [&](size_t offset, uint32_t edges) {
+        size_t here = __builtin_popcount(edges);
+        if(n >= here) {
+            n -= here;
+            return true;
+        }
+        for(; n > 0; n--)
+            edges &= edges - 1;
+        at = offset + __builtin_ctz(edges);
+        return false;
+    });
+    return at;
+}
+
+/**
+ * Split text on '\n' and hand each line (without its newline) to f, stopping
+ * early if f returns false. The piece after the last newline is always
+ * reported, even when empty, matching how the document splits files.
+ */
+template <typename F>
+void forEachLine(std::string_view text, F f) {
+    constexpr size_t BATCH = 256;
+    size_t found[BATCH];
+
+    const char *begin = text.data(), *end = text.data() + text.size();
+    const char *lineStart = begin;
+    while(true) {
+        size_t n = positions(lineStart, end, '\n', found, BATCH);
+        const char *base = lineStart;
+        for(size_t i = 0; i < n; i++) {
+            const char *newline = base + found[i];
+            if(!f(std::string_view(lineStart, newline - lineStart)))
+                return;
+            lineStart = newline + 1;
+        }
+        if(n < BATCH)
+            break;
+    }
+    f(std::string_view(lineStart, end - lineStart));
+}
+
+}
+
+#endif //MINIMA_SCAN_H
@@ -0,0 +1,88 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_SCREENDAMAGE_H
+#define MINIMA_SCREENDAMAGE_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Which rows of the text area need repainting. Edits and caret or
+ * selection moves mark the document lines they touched; resizing or the
+ * gutter widening marks the whole screen, and scrolling only the rows it
+ * brings into view. Lines off screen are ignored.
+ */
+class ScreenDamage {
+    std::vector<char> rows{};
+    int top = 0; // document line shown on the first row
+    int width = 0;
+
+public:
+    /**
+     * Line up with the screen about to be drawn. If it changed size, every
+     * row is dirty. If it scrolled by less than a screen, the rows already
+     * drawn can be moved instead: returns how far to scroll them up
+     * (negative for down), with only the rows that come into view marked.
+     */
+    int frame(int scroll, int height, int columns) {
+        if(height != (int) rows.size() || columns != width) {
+            top = scroll;
+            width = columns;
+            rows.assign(std::max(height, 0), 1);
+            return 0;
+        }
+
+        int shift = scroll - top;
+        top = scroll;
+        if(shift == 0)
+            return 0;
+        if(std::abs(shift) >= height) {
+            markAll();
+            return 0;
+        }
+        // dirty bits travel with their rows
+        if(shift > 0) {
+            std::copy(rows.begin() + shift, rows.end(), rows.begin());
+            std::fill(rows.end() - shift, rows.end(), 1);
+        } else {
+            std::copy_backward(rows.begin(), rows.end() + shift, rows.end());
+            std::fill(rows.begin(), rows.begin() - shift, 1);
+        }
+        return shift;
+    }
+
+    void markAll() {
+        std::fill(rows.begin(), rows.end(), 1);
+    }
+
+    /**
+     * Document lines [first, last) changed
+     */
+    void markLines(int first, int last) {
+        first = std::max(first - top, 0);
+        last = std::min(last - top, (int) rows.size());
+        for(int row = first; row < last; row++)
+            rows[row] = 1;
+    }
+
+    /**
+     * Everything from `first` down moved or changed
+     */
+    void markFrom(int first) {
+        markLines(first, top + (int) rows.size());
+    }
+
+    [[nodiscard]]
+    bool isDirty(int row) const {
+        return rows[row];
+    }
+
+    void clear() {
+        std::fill(rows.begin(), rows.end(), 0);
+    }
+};
+
+#endif //MINIMA_SCREENDAMAGE_H
@@ -0,0 +1,369 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_SEARCH_H
+#define MINIMA_SEARCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstring>
+
+#include "Structure.h"
+#include "LineStorage.h"
+#include "Scan.h"
+
+struct SearchOptions {
+    bool ignoreCase = false; // ASCII letters only
+    bool wholeWord = false;
+};
+
+namespace search_detail {
+
+inline char fold(char c) {
+    return ('A' <= c && c <= 'Z') ? char(c + 32) : c;
+}
+
+inline char other(char c) {
+    if('a' <= c && c <= 'z') return char(c - 32);
+    if('A' <= c && c <= 'Z') return char(c + 32);
+    return c;
+}
+
+inline bool isWordChar(char c) {
+    return std::isalnum((unsigned char) c) || c == '_' || (unsigned char) c >= 0x80;
+}
+
+#ifdef MINIMA_SCAN_X86
+
+// SIMD filter: only starts whose first AND last byte match the needle get
+// verified. With ignoreCase, either case of each byte is accepted.
+// Forward scans starts in [from, to) upwards; backward scans them downwards.
+// Full vectors only: returns the verified start with found = true, or the
+// edge of the part left unscanned (its start going forward, its end going
+// backward) for the scalar loop to finish.
+
+#define MINIMA_SEARCH_FILTER(NAME, TARGET, WIDTH, VEC, LOAD, SET1, CMPEQ, OR, AND, MOVEMASK) \
+template <bool Backward, typename Verify>                                                    \
+__attribute__((target(TARGET)))                                                              \
+size_t NAME(const char *hay, size_t from, size_t to, size_t gap,                             \
+            char first, char firstAlt, char last, char lastAlt,                              \
+            Verify verify, bool &found) {                                                    \
+    VEC f0 = SET1(first), f1 = SET1(firstAlt);                                               \
+    VEC l0 = SET1(last), l1 = SET1(lastAlt);                                                 \
+    found = false;                                                                           \
+    size_t i = Backward ? to : from;                                                         \
+    while(Backward ? i >= from + WIDTH : i + WIDTH <= to) {                                  \
+        size_t base = Backward ? i - WIDTH : i;                                              \
+        VEC a = LOAD((const VEC *) (hay + base));                                            \
+        VEC b = LOAD((const VEC *) (hay + base + gap));                                      \
+        VEC ma = OR(CMPEQ(a, f0), CMPEQ(a, f1));                                             \
+        VEC mb = OR(CMPEQ(b, l0), CMPEQ(b, l1));                                             \
+        unsigned mask = (unsigned) MOVEMASK(AND(ma, mb));                                    \
+        while(mask) {                                                                        \
+            unsigned bit = Backward ? 31 - __builtin_clz(mask) : __builtin_ctz(mask);        \
+            if(verify(base + bit)) {                                                         \
+                found = true;                                                                \
+                return base + bit;                                                           \
+            }                                                                                \
+            mask &= ~(1u << bit);                                                            \
+        }                                                                                    \
+        i = Backward ? i - WIDTH : i + WIDTH;                                                \
+    }                                                                                        \
+    return i;                                                                                \
+}
+
+MINIMA_SEARCH_FILTER(filterAvx2, "avx2", 32, __m256i, _mm256_loadu_si256, _mm256_set1_epi8,
+                     _mm256_cmpeq_epi8, _mm256_or_si256, _mm256_and_si256, _mm256_movemask_epi8)
+MINIMA_SEARCH_FILTER(filterSse2, "sse2", 16, __m128i, _mm_loadu_si128, _mm_set1_epi8,
+                     _mm_cmpeq_epi8, _mm_or_si128, _mm_and_si128, _mm_movemask_epi8)
+
+#undef MINIMA_SEARCH_FILTER
+
+enum class Simd {NONE, SSE2, AVX2};
+
+inline Simd simdLevel() {
+    static const Simd level = [] {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")) return Simd::AVX2;
+        if(__builtin_cpu_supports("sse2")) return Simd::SSE2;
+        return Simd::NONE;
+    }();
+    return level;
+}
+
+#endif
+
+}
+
+/**
+ * Literal matcher for one line of text. Forward search runs a SIMD filter
+ * on the first and last byte of the needle and verifies the survivors,
+ * falling back to Horspool for the tail and on CPUs without SIMD. Backward
+ * search is a mirrored Horspool.
+ */
+class LiteralSearch {
+    std::string pattern; // folded to lower case when ignoring case
+    SearchOptions options;
+    size_t shift[256]{};     // forward horspool, keyed on the byte under the window's end
+    size_t backShift[256]{}; // backward horspool, keyed on the byte under the window's start
+
+    [[nodiscard]]
+    bool equalAt(std::string_view hay, size_t pos) const {
+        if(!options.ignoreCase)
+            return memcmp(hay.data() + pos, pattern.data(), pattern.size()) == 0;
+        for(size_t i = 0; i < pattern.size(); i++)
+            if(search_detail::fold(hay[pos + i]) != pattern[i])
+                return false;
+        return true;
+    }
+
+    [[nodiscard]]
+    bool boundedAt(std::string_view hay, size_t pos) const {
+        if(!options.wholeWord)
+            return true;
+        size_t end = pos + pattern.size();
+        bool before = pos > 0 && search_detail::isWordChar(hay[pos - 1]);
+        bool after = end < hay.size() && search_detail::isWordChar(hay[end]);
+        return !before && !after;
+    }
+
+    [[nodiscard]]
+    unsigned char key(char c) const {
+        return (unsigned char) (options.ignoreCase ? search_detail::fold(c) : c);
+    }
+
+public:
+    LiteralSearch(std::string needle, SearchOptions options) : pattern(std::move(needle)), options(options) {
+        if(options.ignoreCase)
+            for(char &c : pattern)
+                c = search_detail::fold(c);
+
+        size_t m = pattern.size();
+        std::fill(std::begin(shift), std::end(shift), m);
+        std::fill(std::begin(backShift), std::end(backShift), m);
+        for(size_t j = 0; j + 1 < m; j++)
+            shift[(unsigned char) pattern[j]] = m - 1 - j;
+        for(size_t j = m - 1; j >= 1 && j < m; j--)
+            backShift[(unsigned char) pattern[j]] = j;
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return pattern.size();
+    }
+
+    /**
+     * Whether the needle sits at `pos`, boundaries included
+     */
+    [[nodiscard]]
+    bool matchesAt(std::string_view hay, size_t pos) const {
+        return pos + pattern.size() <= hay.size() && equalAt(hay, pos) && boundedAt(hay, pos);
+    }
+
+    /**
+     * Start of the first match at or after `from`, or npos
+     */
+    [[nodiscard]]
+    size_t findIn(std::string_view hay, size_t from) const {
+        size_t m = pattern.size();
+        if(m == 0 || hay.size() < m || from > hay.size() - m)
+            return std::string_view::npos;
+        size_t limit = hay.size() - m + 1; // one past the last possible start
+
+        bool found = false;
+        from = filter<false>(hay, from, limit, found);
+        if(found)
+            return from;
+
+        for(size_t pos = from; pos < limit; pos += shift[key(hay[pos + m - 1])]) {
+            if(matchesAt(hay, pos))
+                return pos;
+        }
+        return std::string_view::npos;
+    }
+
+    /**
+     * Start of the last match at or before `upto`, or npos
+     */
+    [[nodiscard]]
+    size_t findLastIn(std::string_view hay, size_t upto) const {
+        size_t m = pattern.size();
+        if(m == 0 || hay.size() < m)
+            return std::string_view::npos;
+        size_t end = std::min(upto, hay.size() - m) + 1; // one past the last start to try
+
+        bool found = false;
+        end = filter<true>(hay, 0, end, found);
+        if(found)
+            return end;
+
+        long pos = (long) end - 1;
+        while(pos >= 0) {
+            if(matchesAt(hay, pos))
+                return pos;
+            pos -= (long) backShift[key(hay[pos])];
+        }
+        return std::string_view::npos;
+    }
+
+private:
+    /**
+     * Run the SIMD filter over starts in [from, to) if the CPU has one.
+     * Returns where the scalar loop should carry on.
+     */
+    template <bool Backward>
+    size_t filter(std::string_view hay, size_t from, size_t to, bool &found) const {
+#ifdef MINIMA_SCAN_X86
+        using search_detail::Simd;
+        Simd level = search_detail::simdLevel();
+        if(level == Simd::NONE)
+            return Backward ? to : from;
+
+        auto verify = [&](size_t pos) { return equalAt(hay, pos) && boundedAt(hay, pos); };
+        char first = pattern.front(), last = pattern.back();
+        char firstAlt = options.ignoreCase ? search_detail::other(first) : first;
+        char lastAlt = options.ignoreCase ? search_detail::other(last) : last;
+        // starts stay below hay.size() - m + 1, so loads at start + m - 1
+        // never run past the end of the line
+        size_t gap = pattern.size() - 1;
+        if(level == Simd::AVX2)
+            return search_detail::filterAvx2<Backward>(hay.data(), from, to, gap,
+                                                       first, firstAlt, last, lastAlt, verify, found);
+        return search_detail::filterSse2<Backward>(hay.data(), from, to, gap,
+                                                   first, firstAlt, last, lastAlt, verify, found);
+#else
+        return Backward ? to : from;
+#endif
+    }
+};
+
+/**
+ * Finds a literal string in the document, in either direction. A needle
+ * containing newlines matches across lines: its first piece has to end its
+ * line, the middle pieces have to be whole lines, and the last piece has to
+ * start the line after.
+ */
+class TextSearch {
+    SearchOptions options;
+    std::vector<std::string> pieces; // needle split on '\n', folded if ignoring case
+    LiteralSearch literal;
+
+    [[nodiscard]]
+    bool equal(std::string_view text, std::string_view piece) const {
+        if(text.size() != piece.size())
+            return false;
+        if(!options.ignoreCase)
+            return text == piece;
+        for(size_t i = 0; i < text.size(); i++)
+            if(search_detail::fold(text[i]) != piece[i])
+                return false;
+        return true;
+    }
+
+    /**
+     * Where a multi-line match starting on this line would begin, if the
+     * line's tail fits the first piece
+     */
+    [[nodiscard]]
+    std::optional<int> spanStart(std::string_view line) const {
+        const auto &head = pieces.front();
+        if(line.size() < head.size())
+            return std::nullopt;
+        size_t start = line.size() - head.size();
+        if(!equal(line.substr(start), head))
+            return std::nullopt;
+        if(options.wholeWord && start > 0 && search_detail::isWordChar(line[start - 1])
+           && !head.empty() && search_detail::isWordChar(head.front()))
+            return std::nullopt;
+        return (int) start;
+    }
+
+    /**
+     * Whether the lines after `line` complete a multi-line match
+     */
+    [[nodiscard]]
+    bool spanRest(const LineStorage &lines, int line) const {
+        for(size_t i = 1; i < pieces.size(); i++) {
+            if(!lines.hasLine(line + (long) i))
+                return false;
+            std::string_view text = lines.at(line + i).view();
+            const auto &piece = pieces[i];
+            if(i + 1 < pieces.size()) {
+                if(!equal(text, piece))
+                    return false;
+                continue;
+            }
+            // last piece is a prefix of its line
+            if(text.size() < piece.size() || !equal(text.substr(0, piece.size()), piece))
+                return false;
+            if(options.wholeWord && text.size() > piece.size() && !piece.empty()
+               && search_detail::isWordChar(piece.back()) && search_detail::isWordChar(text[piece.size()]))
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]]
+    Range spanRange(int line, int start) const {
+        int last = line + (int) pieces.size() - 1;
+        return {{line, start}, {last, (int) pieces.back().size()}};
+    }
+
+public:
+    TextSearch(const std::string &needle, SearchOptions options)
+            : options(options), literal(needle, options) {
+        scan::forEachLine(needle, [this, options](std::string_view piece) {
+            std::string folded(piece);
+            if(options.ignoreCase)
+                for(char &c : folded)
+                    c = search_detail::fold(c);
+            pieces.push_back(std::move(folded));
+            return true;
+        });
+    }
+
+    /**
+     * First match starting at or after `from` when direction > 0, or the
+     * last one starting at or before it otherwise
+     */
+    [[nodiscard]]
+    std::optional<Range> find(const LineStorage &lines, Point from, int direction) const {
+        std::optional<Range> result;
+        bool multiLine = pieces.size() > 1;
+
+        auto visit = [&](size_t number, const Line &line) {
+            std::string_view text = line.view();
+            bool first = (int) number == from.line;
+
+            if(multiLine) {
+                auto start = spanStart(text);
+                bool inReach = start && (!first || (direction > 0 ? *start >= from.chara : *start <= from.chara));
+                if(inReach && spanRest(lines, (int) number))
+                    result = spanRange((int) number, *start);
+                return !result;
+            }
+
+            size_t pos;
+            if(direction > 0)
+                pos = literal.findIn(text, first ? from.chara : 0);
+            else
+                pos = literal.findLastIn(text, first ? from.chara : std::string_view::npos);
+            if(pos != std::string_view::npos)
+                result = Range({(int) number, (int) pos}, {(int) number, (int) (pos + literal.size())});
+            return !result;
+        };
+
+        // spanRest reads the lines after the one visited
+        size_t ahead = pieces.size() - 1;
+        if(direction > 0)
+            lines.scanForward(from.line, visit, ahead);
+        else
+            lines.scanBackward(from.line, visit, ahead);
+        return result;
+    }
+};
+
+#endif //MINIMA_SEARCH_H
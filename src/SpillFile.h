@@ -0,0 +1,97 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_SPILLFILE_H
+#define MINIMA_SPILLFILE_H
+
+#include <string>
+#include <string_view>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Trace.h"
+
+/**
+ * Append-only scratch file for data that doesn't need to stay in memory.
+ * It is unlinked as soon as it's created, so it never shows up on disk and
+ * goes away with the process however that ends.
+ */
+class SpillFile {
+    int fd = -1;
+    off_t end = 0;
+
+    bool openFile() {
+        if(fd >= 0)
+            return true;
+        const char *dir = getenv("TMPDIR");
+        std::string path = std::string(dir && *dir ? dir : "/tmp") + "/minima-spill-XXXXXX";
+        fd = mkstemp(path.data());
+        if(fd < 0)
+            return false;
+        unlink(path.c_str());
+        return true;
+    }
+
+public:
+    SpillFile() = default;
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
+
+    ~SpillFile() {
+        if(fd >= 0)
+            close(fd);
+    }
+
+    /**
+     * Append data, returning where it went, or -1 if it couldn't be written
+     */
+    off_t append(std::string_view data) {
+        TRACE_SCOPE("SpillFile::append");
+        if(!openFile())
+            return -1;
+        off_t at = end;
+        for(size_t done = 0; done < data.size();) {
+            ssize_t n = pwrite(fd, data.data() + done, data.size() - done, at + (off_t) done);
+            if(n < 0) {
+                if(errno == EINTR) continue;
+                return -1;
+            }
+            done += n;
+        }
+        end += (off_t) data.size();
+        return at;
+    }
+
+    bool read(off_t offset, size_t size, std::string &out) const {
+        TRACE_SCOPE("SpillFile::read");
+        out.resize(size);
+        for(size_t done = 0; done < size;) {
+            ssize_t n = pread(fd, out.data() + done, size - done, offset + (off_t) done);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+    /**
+     * Drop everything from `offset` on
+     */
+    void truncate(off_t offset) {
+        if(fd < 0 || offset >= end)
+            return;
+        end = offset;
+        (void) !ftruncate(fd, end);
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return end;
+    }
+};
+
+#endif //MINIMA_SPILLFILE_H
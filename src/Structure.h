@@ -1,4 +1,7 @@
+#include <string>
 #include <utility>
+#include <vector>
+#include <memory>
 
 //
 // Created by reschivon on 4/14/22.
@@ -55,15 +58,35 @@ public:
 
 Range Range::empty = {{0, 0}, {0, 0}};
 
+/**
+ * Lines [first, first + removed) were replaced by `added` lines. The first
+ * `prefix` bytes of the first line and the last `suffix` bytes of the last
+ * are text that was there before, at the start of the first line replaced
+ * and the end of the last.
+ */
+struct LineChange {
+    int first, removed, added;
+    size_t prefix = 0, suffix = 0;
+};
+
+class Line;
+// lines taken out of the document whole; joined by newlines they are the text
+using LineRun = std::vector<Line>;
+
 struct Action {
     enum Type {ADD, DELETE};
     Type type;
     std::string heft;
     Range range;
+    bool chained = false;   // undone and redone together with the action before it
+    bool mergeable = true;  // may absorb, or be absorbed by, a neighbouring keystroke
+    // a big delete keeps its lines here instead of in heft; they move back
+    // into the document on undo and out again on redo
+    std::shared_ptr<LineRun> lines{};
 };
 
 enum EditMode {EDIT=0, COMMAND=1};
-enum REQUESTED_ACTION {SAVE, TOEDIT, TOCMD, NOTHING};
+enum REQUESTED_ACTION {SAVE, WRITE, TOEDIT, TOCMD, TIMINGS, NOTHING}; // SAVE also quits, WRITE doesn't
 
 // Shamelessly ripped from SO
 template <typename T> int signum(T val) {
@@ -0,0 +1,131 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_TRACE_H
+#define MINIMA_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * Timings of the hot paths, kept so a slowdown can be looked at after the
+ * fact without a profiler. TRACE_SCOPE("name") at the top of a block times
+ * the block. The most recent EVENTS of them stay in a ring buffer, and
+ * tracing::dump writes those out as Chrome trace_event JSON, which
+ * chrome://tracing and Perfetto open.
+ *
+ * Recording takes two clock reads and one atomic add. Any thread may record.
+ * A slot carries the number of the event in it, so a dump skips slots that
+ * are being overwritten as it reads them. Building without MINIMA_TRACE
+ * compiles all of it out.
+ */
+#ifdef MINIMA_TRACE
+namespace tracing {
+    constexpr bool enabled = true;
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t EVENTS = 1 << 15;
+
+    struct Slot {
+        // 1 + the event's number once it's written, 0 while it's being written
+        std::atomic<uint64_t> seq{0};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<int64_t> start{0}, duration{0};
+        std::atomic<uint32_t> thread{0};
+    };
+
+    inline Slot ring[EVENTS];
+    inline std::atomic<uint64_t> next{0};
+    inline const Clock::time_point epoch = Clock::now();
+
+    inline uint32_t threadNumber() {
+        static std::atomic<uint32_t> threads{0};
+        thread_local uint32_t number = ++threads;
+        return number;
+    }
+
+    inline int64_t nanosSince(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    /**
+     * Times its own lifetime under `name`, which must be a string literal
+     */
+    class Scope {
+        const char *name;
+        Clock::time_point start;
+
+    public:
+        explicit Scope(const char *name) : name(name), start(Clock::now()) {}
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope() {
+            auto end = Clock::now();
+            uint64_t number = next.fetch_add(1, std::memory_order_relaxed);
+            Slot &slot = ring[number % EVENTS];
+            slot.seq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.start.store(nanosSince(epoch, start), std::memory_order_relaxed);
+            slot.duration.store(nanosSince(start, end), std::memory_order_relaxed);
+            slot.thread.store(threadNumber(), std::memory_order_relaxed);
+            slot.seq.store(number + 1, std::memory_order_release);
+        }
+    };
+
+    /**
+     * Write the events in the ring to `path` as a Chrome trace. Returns how
+     * many went out, -1 if the file couldn't be written.
+     */
+    inline long dump(const std::string &path) {
+        FILE *out = fopen(path.c_str(), "w");
+        if(!out)
+            return -1;
+        uint64_t last = next.load(std::memory_order_acquire);
+        uint64_t first = last > EVENTS ? last - EVENTS : 0;
+        long written = 0;
+        fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+        for(uint64_t number = first; number < last; number++) {
+            Slot &slot = ring[number % EVENTS];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            const char *name = slot.name.load(std::memory_order_relaxed);
+            int64_t start = slot.start.load(std::memory_order_relaxed);
+            int64_t duration = slot.duration.load(std::memory_order_relaxed);
+            uint32_t thread = slot.thread.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(seq != number + 1 || slot.seq.load(std::memory_order_relaxed) != seq)
+                continue; // overwritten or still being written
+            // names are literals from the code, nothing in them needs escaping
+            fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    written ? "," : "", name, thread, (double) start / 1000, (double) duration / 1000);
+            written++;
+        }
+        fprintf(out, "\n]}\n");
+        bool ok = !ferror(out);
+        return fclose(out) == 0 && ok ? written : -1;
+    }
+}
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) tracing::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+namespace tracing {
+    constexpr bool enabled = false;
+
+    inline long dump(const std::string &) {
+        return -1;
+    }
+}
+
+#define TRACE_SCOPE(name) ((void) 0)
+#endif
+
+#endif //MINIMA_TRACE_H
@@ -0,0 +1,124 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+#ifndef MINIMA_WORDINDEX_H
+#define MINIMA_WORDINDEX_H
+
+#include <cstdint>
+
+#include "LineCounts.h"
+#include "LineStorage.h"
+#include "Scan.h"
+#include "Structure.h"
+
+/**
+ * Word edges, the places where text switches between whitespace and not,
+ * for word motions. Each line's edge count is cached in LineCounts, so a
+ * motion skips the lines it crosses with a Fenwick lookup and only scans
+ * the lines it starts and ends on.
+ *
+ * The document is seen as every line followed by a newline, so each line
+ * holds exactly two edges per word and nothing spans lines.
+ */
+class WordIndex {
+    /**
+     * Edges among columns [from, to] of a line, the newline at its end
+     * included
+     */
+    static size_t edgesIn(std::string_view text, size_t from, size_t to) {
+        bool spaceBefore = from == 0 || scan::detail::isSpace(text[from - 1]);
+        size_t stop = to < text.size() ? to + 1 : text.size();
+        size_t found = from < stop ? scan::wordEdges(text.data() + from, text.data() + stop, spaceBefore) : 0;
+        if(to >= text.size() && !text.empty() && !scan::detail::isSpace(text.back()))
+            found++;
+        return found;
+    }
+
+    /**
+     * Column of the n-th (from 0) edge at or after column `from`, or
+     * SIZE_MAX
+     */
+    static size_t nthEdge(std::string_view text, size_t from, size_t n) {
+        bool spaceBefore = from == 0 || scan::detail::isSpace(text[from - 1]);
+        if(from < text.size()) {
+            size_t at = scan::nthWordEdge(text.data() + from, text.data() + text.size(), n, spaceBefore);
+            if(at != SIZE_MAX)
+                return from + at;
+        }
+        if(edgesIn(text, from, text.size()) == n + 1)
+            return text.size();
+        return SIZE_MAX;
+    }
+
+    struct Edges {
+        uint32_t operator()(const LineStorage &lines, size_t line) const {
+            return (uint32_t) edgesIn(lines.at(line).view(), 0, SIZE_MAX);
+        }
+    };
+
+    LineCounts<Edges> counts{};
+
+    /**
+     * The spot just before column `column` of `line`, which for column 0 is
+     * the end of the line above
+     */
+    static Point before(const LineStorage &lines, size_t line, size_t column) {
+        if(column > 0)
+            return {(int) line, (int) column - 1};
+        if(line == 0)
+            return Point::origin;
+        return {(int) line - 1, (int) lines.at(line - 1).size()};
+    }
+
+public:
+    void reset() {
+        counts.reset();
+    }
+
+    void linesChanged(int first, int removed, int added) {
+        counts.linesChanged(first, removed, added);
+    }
+
+    /**
+     * Where walking `num` edges from `start` ends: forward it's the
+     * num-th edge after start, backward the spot just before the num-th
+     * edge at or before it. Stops at either end of the document.
+     */
+    [[nodiscard]]
+    Point step(const LineStorage &lines, Point start, int num) const {
+        size_t line = start.line;
+        std::string_view text = lines.at(line).view();
+        size_t column = std::min((size_t) start.chara, text.size());
+
+        if(num == 0)
+            return {(int) line, (int) column};
+        if(num > 0) {
+            size_t remaining = num;
+            if(column < text.size()) {
+                size_t at = nthEdge(text, column + 1, remaining - 1);
+                if(at != SIZE_MAX)
+                    return {(int) line, (int) at};
+                remaining -= edgesIn(text, column + 1, text.size());
+            }
+            if(auto found = counts.after(lines, line, remaining - 1)) {
+                auto [at, rank] = *found;
+                return {(int) at, (int) nthEdge(lines.at(at).view(), 0, rank)};
+            }
+            size_t last = lines.size() - 1; // the walk indexed everything already
+            return {(int) last, (int) lines.at(last).size()};
+        }
+
+        size_t remaining = -(long) num;
+        size_t own = edgesIn(text, 0, column);
+        if(own >= remaining)
+            return before(lines, line, nthEdge(text, 0, own - remaining));
+        if(auto found = counts.before(lines, line, remaining - own - 1)) {
+            auto [at, rank] = *found;
+            return before(lines, at, nthEdge(lines.at(at).view(), 0, rank));
+        }
+        return Point::origin;
+    }
+};
+
+#endif //MINIMA_WORDINDEX_H
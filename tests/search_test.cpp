@@ -0,0 +1,67 @@
+//
+// Created by reschivon on 10/18/26.
+//
+
+// Multi-line searches over a file that's only partly indexed. The search
+// looks at the lines after the one it visits, and those used to be indexed
+// while the walk still held the block they went into.
+
+#include "Search.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+    int failures = 0;
+
+    void check(bool ok, const char *what, int at) {
+        if(!ok) {
+            fprintf(stderr, "FAIL: %s (match at line %d)\n", what, at);
+            failures++;
+        }
+    }
+
+    /**
+     * 100k lines of "x", with "zz" on line `at` + 1 if `at` >= 0
+     */
+    std::string writeFile(int at) {
+        char path[] = "/tmp/minima_search_XXXXXX";
+        int fd = mkstemp(path);
+        close(fd);
+        std::ofstream out(path);
+        for(int i = 0; i < 100000; i++)
+            out << (i == at + 1 ? "zz" : "x") << '\n';
+        return path;
+    }
+
+    std::optional<Range> find(int at, Point from, int direction) {
+        std::string path = writeFile(at);
+        LineStorage lines;
+        lines.load(FileMap::open(path));
+        unlink(path.c_str());
+        return TextSearch("x\nzz", {}).find(lines, from, direction);
+    }
+}
+
+int main() {
+    // the first index stops a little past line 4096, the next ones further on
+    for(int at : {10, 4095, 4096, 4097, 8192, 8193, 8194, 12290, 99998}) {
+        Range expected({at, 0}, {at + 1, 2});
+
+        auto forward = find(at, {0, 0}, 1);
+        check(forward && forward->start == expected.start && forward->end == expected.end, "forward", at);
+
+        auto backward = find(at, {at + 1, 0}, -1);
+        check(backward && backward->start == expected.start && backward->end == expected.end, "backward", at);
+    }
+
+    check(!find(-1, {0, 0}, 1), "no match forward", -1);
+    check(!find(-1, {99999, 0}, -1), "no match backward", -1);
+
+    if(failures)
+        return 1;
+    printf("ok\n");
+    return 0;
+}